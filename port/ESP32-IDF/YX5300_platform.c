@@ -32,9 +32,31 @@
 #include "YX5300_platform.h"
 #include "sdkconfig.h"
 #include "esp_system.h"
-#include "driver/uart.h"
-#include "driver/gpio.h"
-#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
+#if (YX5300_USE_LIBRARY)
+#include "nvs.h"
+#include <stdio.h>
+#endif
+
+
+
+/* Private Constants ------------------------------------------------------------*/
+#define YX5300_UART_READ_SIZE       256
+#define YX5300_UART_QUEUE_SIZE      16
+#define YX5300_UART_PATTERN_CHAR    0xEF
+
+
+
+/* Private Variables ------------------------------------------------------------*/
+static YX5300_Platform_Port_t Platform_DefaultPort =
+{
+  .UartNum = YX5300_UART_NUM,
+  .TxGpio = YX5300_UART_TXD_GPIO,
+  .RxGpio = YX5300_UART_RXD_GPIO,
+};
+
+static const uint32_t Platform_AutoBaudList[] = YX5300_AUTO_BAUD_LIST;
 
 
 
@@ -44,45 +66,311 @@
  ==================================================================================
  */
 
+#if (YX5300_RX_TASK_ENABLE)
+static void
+Platform_RxTask(void *Param)
+{
+  YX5300_Platform_Port_t *Port = (YX5300_Platform_Port_t *)Param;
+  uart_event_t Event;
+  uint8_t Buffer[YX5300_UART_READ_SIZE];
+  size_t Buffered = 0;
+  int Len = 0;
+
+  for (;;)
+  {
+    if (xQueueReceive(Port->EventQueue, &Event, portMAX_DELAY) != pdTRUE)
+      continue;
+
+    switch (Event.type)
+    {
+    case UART_PATTERN_DET:
+      uart_pattern_pop_pos(Port->UartNum);
+      // fall through
+    case UART_DATA:
+      uart_get_buffered_data_len(Port->UartNum, &Buffered);
+      if (Buffered > sizeof(Buffer))
+        Buffered = sizeof(Buffer);
+      if (Buffered == 0)
+        break;
+
+      Len = uart_read_bytes(Port->UartNum, Buffer, Buffered, 0);
+      if (Len > 0)
+        YX5300_RxBuffer(Port->Handler, Buffer, (uint16_t)Len, NULL);
+      break;
+
+    case UART_FIFO_OVF:
+    case UART_BUFFER_FULL:
+      uart_flush_input(Port->UartNum);
+      xQueueReset(Port->EventQueue);
+      break;
+
+    default:
+      break;
+    }
+  }
+}
+#endif
+
+#if (YX5300_USE_GROUP)
+static void
+Platform_GroupTask(void *Param)
+{
+  YX5300_Group_t *Group = (YX5300_Group_t *)Param;
+  TickType_t LastWake = xTaskGetTickCount();
+  TickType_t Period = pdMS_TO_TICKS(YX5300_GROUP_TASK_PERIOD);
+
+  if (Period == 0)
+    Period = 1;
+
+  for (;;)
+  {
+    YX5300_GroupProcess(Group);
+    vTaskDelayUntil(&LastWake, Period);
+  }
+}
+#endif
+
+static int8_t
+Platform_ProbeBaud(YX5300_Platform_Port_t *Port, uint32_t Baud)
+{
+  // Query status with checksum and without feedback, so the only reply is 0x42
+  static const uint8_t Query[] =
+    {0x7E, 0xFF, 0x06, 0x42, 0x00, 0x00, 0x00, 0xFE, 0xB9, 0xEF};
+  uint8_t Response[YX5300_RESPONSE_SIZE];
+  TickType_t Timeout = pdMS_TO_TICKS(YX5300_AUTO_BAUD_TIMEOUT);
+
+  if (uart_set_baudrate(Port->UartNum, Baud) != ESP_OK)
+    return -1;
+
+  uart_flush_input(Port->UartNum);
+  if (uart_write_bytes(Port->UartNum, Query, sizeof(Query)) != sizeof(Query))
+    return -1;
+  uart_wait_tx_done(Port->UartNum, Timeout);
+
+  if (uart_read_bytes(Port->UartNum, Response, sizeof(Response), Timeout) !=
+      sizeof(Response))
+    return -1;
+
+  if (Response[0] != 0x7E || Response[3] != 0x42 || Response[9] != 0xEF)
+    return -1;
+
+  return 0;
+}
+
+static void
+Platform_AutoBaud(YX5300_Platform_Port_t *Port)
+{
+  uint8_t i = 0;
+
+  for (i = 0; i < sizeof(Platform_AutoBaudList) / sizeof(Platform_AutoBaudList[0]); i++)
+  {
+    if (Platform_AutoBaudList[i] <= Port->Baud)
+      break;
+
+    if (Platform_ProbeBaud(Port, Platform_AutoBaudList[i]) == 0)
+    {
+      Port->Baud = Platform_AutoBaudList[i];
+      return;
+    }
+  }
+
+  uart_set_baudrate(Port->UartNum, Port->Baud);
+  uart_flush_input(Port->UartNum);
+}
+
 static int8_t
-YX5300_Platform_Init(void)
+Platform_Init(void *UserCtx)
 {
+  YX5300_Platform_Port_t *Port = (YX5300_Platform_Port_t *)UserCtx;
   uart_config_t uart_config = {
-      .baud_rate = 9600,
+      .baud_rate = YX5300_UART_BAUD,
       .data_bits = UART_DATA_8_BITS,
       .parity = UART_PARITY_DISABLE,
       .stop_bits = UART_STOP_BITS_1,
       .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
       .source_clk = UART_SCLK_APB};
-  uart_param_config(YX5300_UART_NUM, &uart_config);
-  uart_set_pin(YX5300_UART_NUM, YX5300_UART_TXD_GPIO, YX5300_UART_RXD_GPIO, -1, -1);
-  uart_driver_install(YX5300_UART_NUM, 256, 256, 0, NULL, 0);
+
+  if (Port->Baud == 0)
+    Port->Baud = YX5300_UART_BAUD;
+  if (Port->RxBufferSize == 0)
+    Port->RxBufferSize = YX5300_UART_RX_BUFFER_SIZE;
+  if (Port->TxBufferSize == 0)
+    Port->TxBufferSize = YX5300_UART_TX_BUFFER_SIZE;
+
+  uart_config.baud_rate = Port->Baud;
+  uart_param_config(Port->UartNum, &uart_config);
+  uart_set_pin(Port->UartNum, Port->TxGpio, Port->RxGpio, -1, -1);
+
+#if (YX5300_RX_TASK_ENABLE)
+  if (uart_driver_install(Port->UartNum,
+                          Port->RxBufferSize, Port->TxBufferSize,
+                          YX5300_UART_QUEUE_SIZE, &Port->EventQueue, 0) != ESP_OK)
+    return -1;
+
+  // Probe before the Rx task takes the received data
+  if (Port->AutoBaud)
+  {
+    Platform_AutoBaud(Port);
+    xQueueReset(Port->EventQueue);
+  }
+
+  uart_enable_pattern_det_baud_intr(Port->UartNum, YX5300_UART_PATTERN_CHAR,
+                                    1, 1, 0, 0);
+  uart_pattern_queue_reset(Port->UartNum, YX5300_UART_QUEUE_SIZE);
+
+  if (xTaskCreate(Platform_RxTask, "YX5300_Rx", YX5300_RX_TASK_STACK, Port,
+                  YX5300_RX_TASK_PRIORITY, &Port->RxTask) != pdPASS)
+  {
+    uart_driver_delete(Port->UartNum);
+    return -1;
+  }
+#else
+  if (uart_driver_install(Port->UartNum,
+                          Port->RxBufferSize, Port->TxBufferSize,
+                          0, NULL, 0) != ESP_OK)
+    return -1;
+
+  if (Port->AutoBaud)
+    Platform_AutoBaud(Port);
+#endif
 
   return 0;
 }
 
 static int8_t
-YX5300_Platform_DeInit(void)
+Platform_DeInit(void *UserCtx)
 {
-  uart_driver_delete(YX5300_UART_NUM);
+  YX5300_Platform_Port_t *Port = (YX5300_Platform_Port_t *)UserCtx;
+
+#if (YX5300_RX_TASK_ENABLE)
+  if (Port->RxTask)
+  {
+    vTaskDelete(Port->RxTask);
+    Port->RxTask = NULL;
+  }
+#endif
+  uart_driver_delete(Port->UartNum);
   return 0;
 }
 
+// Used for pacing delays (e.g. gaps between frames), so it is accurate
 static int8_t
-YX5300_Platform_Delay(uint16_t Delay)
+Platform_Delay(void *UserCtx, uint16_t Delay)
 {
-  vTaskDelay(Delay / portTICK_PERIOD_MS);
+  const int64_t TickUs = (int64_t)portTICK_PERIOD_MS * 1000;
+  int64_t Deadline = esp_timer_get_time() + (int64_t)Delay * 1000;
+  int64_t Remain = 0;
+
+  (void)UserCtx;
+
+  // vTaskDelay never waits longer than the given ticks, so the whole ticks are
+  // waited by blocking and only the part shorter than a tick by busy loop
+  while ((Remain = Deadline - esp_timer_get_time()) >= TickUs)
+    vTaskDelay((TickType_t)(Remain / TickUs));
+
+  while ((Remain = Deadline - esp_timer_get_time()) > 0)
+    esp_rom_delay_us((uint32_t)Remain);
+
   return 0;
 }
 
+// Used while polling for responses, so the Rx task (or any lower priority
+// task) can run instead of a busy wait
+static void
+Platform_Yield(void *UserCtx)
+{
+  (void)UserCtx;
+  vTaskDelay(1);
+}
+
 static int8_t
-YX5300_Platform_Send(uint8_t *Data, uint8_t Len)
+Platform_Send(void *UserCtx, uint8_t *Data, uint8_t Len)
 {
-  uart_wait_tx_done(YX5300_UART_NUM, portMAX_DELAY);
-  uart_write_bytes(YX5300_UART_NUM, Data, Len);
-  
+  YX5300_Platform_Port_t *Port = (YX5300_Platform_Port_t *)UserCtx;
+  size_t Free = 0;
+  int8_t Sent = 0;
+  int8_t Part = 0;
+
+  if (Port->NonBlockingSend)
+  {
+#if (YX5300_USE_BATCH)
+    // Only the first frame of a batch is sent, the driver sends the rest after
+    // the batch gap
+    if (Len > YX5300_FRAME_SIZE)
+    {
+      Len = YX5300_FRAME_SIZE;
+      Part = 1;
+    }
+#endif
+
+    // uart_write_bytes blocks only if there is no room in Tx ring buffer
+    if (uart_get_tx_buffer_free_size(Port->UartNum, &Free) != ESP_OK ||
+        Free < Len)
+      return -1;
+  }
+  else
+  {
+    uart_wait_tx_done(Port->UartNum, portMAX_DELAY);
+
+#if (YX5300_USE_BATCH)
+    // Frames of a batch are sent with a gap, so the module is not busy for them.
+    // If a frame fails, the number of sent frames is returned, so the driver
+    // does not send them again.
+    while (Len > YX5300_FRAME_SIZE)
+    {
+      if (uart_write_bytes(Port->UartNum, Data, YX5300_FRAME_SIZE) != YX5300_FRAME_SIZE)
+        return Sent ? Sent : -1;
+      Data += YX5300_FRAME_SIZE;
+      Len -= YX5300_FRAME_SIZE;
+      Sent++;
+
+      uart_wait_tx_done(Port->UartNum, portMAX_DELAY);
+      Platform_Delay(UserCtx, YX5300_BATCH_GAP);
+    }
+#endif
+  }
+
+  if (uart_write_bytes(Port->UartNum, Data, Len) != Len)
+    return Sent ? Sent : -1;
+
+  return Part;
+}
+
+#if (!YX5300_RX_TASK_ENABLE)
+static int8_t
+Platform_Receive(void *UserCtx, uint8_t *Data, uint8_t Size, uint8_t *Len)
+{
+  YX5300_Platform_Port_t *Port = (YX5300_Platform_Port_t *)UserCtx;
+  int Result = uart_read_bytes(Port->UartNum, Data, Size, 0);
+
+  if (Result < 0)
+    return -1;
+  *Len = (uint8_t)Result;
+
   return 0;
 }
+#endif
+
+static uint32_t
+Platform_GetTick(void *UserCtx)
+{
+  (void)UserCtx;
+  return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+static void
+Platform_Lock(void *UserCtx)
+{
+  YX5300_Platform_Port_t *Port = (YX5300_Platform_Port_t *)UserCtx;
+  portENTER_CRITICAL_SAFE(&Port->Lock);
+}
+
+static void
+Platform_Unlock(void *UserCtx)
+{
+  YX5300_Platform_Port_t *Port = (YX5300_Platform_Port_t *)UserCtx;
+  portEXIT_CRITICAL_SAFE(&Port->Lock);
+}
 
 
 
@@ -94,14 +382,177 @@ YX5300_Platform_Send(uint8_t *Data, uint8_t Len)
 
 /**
  * @brief  Initialize platform device to communicate YX5300.
+ * @note   Each module must have its own handler and platform instance.
  * @param  Handler: Pointer to handler
+ * @param  Port: Pointer to platform instance (UART and pins). If it is NULL, the
+ *               default instance (YX5300_UART_NUM, YX5300_UART_TXD_GPIO and
+ *               YX5300_UART_RXD_GPIO) is used.
  * @retval None
  */
 void
-YX5300_Platform_Init(YX5300_Handler_t *Handler)
+YX5300_Platform_Init(YX5300_Handler_t *Handler, YX5300_Platform_Port_t *Port)
+{
+  if (Port == NULL)
+    Port = &Platform_DefaultPort;
+  Port->Handler = Handler;
+  portMUX_INITIALIZE(&Port->Lock);
+
+  YX5300_PLATFORM_LINK_USERCTX(Handler, Port);
+  YX5300_PLATFORM_LINK_INIT(Handler, Platform_Init);
+  YX5300_PLATFORM_LINK_DEINIT(Handler, Platform_DeInit);
+  YX5300_PLATFORM_LINK_DELAY(Handler, Platform_Delay);
+  YX5300_PLATFORM_LINK_SEND(Handler, Platform_Send);
+#if (!YX5300_RX_TASK_ENABLE)
+  YX5300_PLATFORM_LINK_RECEIVE(Handler, Platform_Receive);
+#endif
+  YX5300_PLATFORM_LINK_GETTICK(Handler, Platform_GetTick);
+  YX5300_PLATFORM_LINK_LOCK(Handler, Platform_Lock, Platform_Unlock);
+  YX5300_PLATFORM_LINK_YIELD(Handler, Platform_Yield);
+}
+
+
+/**
+ * @brief  Check whether all sent data is transmitted completely.
+ * @note   The UART driver does not report Tx completion through its event
+ *         queue, so the Tx done state of driver is read without waiting.
+ * @param  Handler: Pointer to handler initialized by YX5300_Platform_Init
+ * @retval 
+ *         -  1: All data is transmitted.
+ *         -  0: Transmission is in progress.
+ */
+int8_t
+YX5300_Platform_TxDone(YX5300_Handler_t *Handler)
+{
+  YX5300_Platform_Port_t *Port = (YX5300_Platform_Port_t *)Handler->Platform.UserCtx;
+
+  return (uart_wait_tx_done(Port->UartNum, 0) == ESP_OK) ? 1 : 0;
+}
+
+
+/**
+ * @brief  Wait for all sent data to be transmitted completely.
+ * @note   The task is blocked until the Tx done interrupt of UART (no busy
+ *         wait).
+ * @param  Handler: Pointer to handler initialized by YX5300_Platform_Init
+ * @param  Timeout: Maximum time to wait in ms
+ * @retval 
+ *         -  0: All data is transmitted.
+ *         - -1: Timeout expired.
+ */
+int8_t
+YX5300_Platform_Flush(YX5300_Handler_t *Handler, uint16_t Timeout)
 {
-  YX5300_PLATFORM_LINK_INIT(Handler, YX5300_Platform_Init);
-  YX5300_PLATFORM_LINK_DEINIT(Handler, YX5300_Platform_DeInit);
-  YX5300_PLATFORM_LINK_DELAY(Handler, YX5300_Platform_Delay);
-  YX5300_PLATFORM_LINK_SEND(Handler, YX5300_Platform_Send);
+  YX5300_Platform_Port_t *Port = (YX5300_Platform_Port_t *)Handler->Platform.UserCtx;
+
+  if (uart_wait_tx_done(Port->UartNum, pdMS_TO_TICKS(Timeout)) != ESP_OK)
+    return -1;
+
+  return 0;
+}
+
+
+#if (YX5300_USE_GROUP)
+/**
+ * @brief  Create a task that processes a group of handlers.
+ * @note   The task calls YX5300_GroupProcess every YX5300_GROUP_TASK_PERIOD ms.
+ *         So one task serves all modules instead of one task per module.
+ * @param  Group: Pointer to group initialized by YX5300_GroupInit
+ * @param  Task: Pointer to store the task handle (can be NULL)
+ * @retval 
+ *         -  0: The operation was successful.
+ *         - -1: The operation failed. 
+ */
+int8_t
+YX5300_Platform_StartGroupTask(YX5300_Group_t *Group, TaskHandle_t *Task)
+{
+  if (Group == NULL)
+    return -1;
+
+  if (xTaskCreate(Platform_GroupTask, "YX5300_Group", YX5300_GROUP_TASK_STACK,
+                  Group, YX5300_GROUP_TASK_PRIORITY, Task) != pdPASS)
+    return -1;
+
+  return 0;
+}
+#endif
+
+
+#if (YX5300_USE_LIBRARY)
+static void
+Platform_LibraryKey(YX5300_Handler_t *Handler, char *Key, size_t Size)
+{
+  YX5300_Platform_Port_t *Port = (YX5300_Platform_Port_t *)Handler->Platform.UserCtx;
+
+  snprintf(Key, Size, "lib%d", (int)Port->UartNum);
+}
+
+
+/**
+ * @brief  Store the media library index of handler in NVS.
+ * @note   NVS must be initialized by nvs_flash_init. The snapshot of each
+ *         instance is stored with its own key based on UART number.
+ * @param  Handler: Pointer to handler initialized by YX5300_Platform_Init
+ * @retval 
+ *         -  0: The operation was successful.
+ *         - -1: The operation failed. 
+ */
+int8_t
+YX5300_Platform_LibrarySave(YX5300_Handler_t *Handler)
+{
+  uint8_t Buffer[YX5300_LIBRARY_SNAPSHOT_SIZE(255)];
+  uint16_t Len = 0;
+  char Key[8];
+  nvs_handle_t Nvs;
+  esp_err_t Err = ESP_OK;
+
+  if (YX5300_LibrarySave(Handler, Buffer, sizeof(Buffer), &Len) != YX5300_OK)
+    return -1;
+
+  if (nvs_open(YX5300_NVS_NAMESPACE, NVS_READWRITE, &Nvs) != ESP_OK)
+    return -1;
+
+  Platform_LibraryKey(Handler, Key, sizeof(Key));
+  Err = nvs_set_blob(Nvs, Key, Buffer, Len);
+  if (Err == ESP_OK)
+    Err = nvs_commit(Nvs);
+  nvs_close(Nvs);
+
+  return (Err == ESP_OK) ? 0 : -1;
+}
+
+
+/**
+ * @brief  Load the media library index of handler from NVS.
+ * @note   Call this function after YX5300_LibrarySetBuffer and before
+ *         YX5300_Init. If the total number of tracks reported by the module
+ *         matches the snapshot, the folders are not scanned again.
+ * @param  Handler: Pointer to handler initialized by YX5300_Platform_Init
+ * @retval 
+ *         -  0: The operation was successful.
+ *         - -1: The operation failed (e.g. no snapshot is stored). 
+ */
+int8_t
+YX5300_Platform_LibraryLoad(YX5300_Handler_t *Handler)
+{
+  uint8_t Buffer[YX5300_LIBRARY_SNAPSHOT_SIZE(255)];
+  size_t Len = sizeof(Buffer);
+  char Key[8];
+  nvs_handle_t Nvs;
+  esp_err_t Err = ESP_OK;
+
+  if (nvs_open(YX5300_NVS_NAMESPACE, NVS_READONLY, &Nvs) != ESP_OK)
+    return -1;
+
+  Platform_LibraryKey(Handler, Key, sizeof(Key));
+  Err = nvs_get_blob(Nvs, Key, Buffer, &Len);
+  nvs_close(Nvs);
+
+  if (Err != ESP_OK)
+    return -1;
+
+  if (YX5300_LibraryLoad(Handler, Buffer, (uint16_t)Len) != YX5300_OK)
+    return -1;
+
+  return 0;
 }
+#endif
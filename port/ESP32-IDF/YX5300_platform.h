@@ -40,13 +40,102 @@ extern "C" {
 /* Includes ---------------------------------------------------------------------*/
 #include "YX5300.h"
 #include <stdint.h>
+#include "driver/uart.h"
+#include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
 
 
 /* Functionality Options --------------------------------------------------------*/
+/**
+ * @brief  UART and pins of the default instance (used when no instance is passed
+ *         to YX5300_Platform_Init)
+ */
 #define YX5300_UART_NUM       UART_NUM_2
 #define YX5300_UART_TXD_GPIO  GPIO_NUM_23
 #define YX5300_UART_RXD_GPIO  GPIO_NUM_19
 
+/**
+ * @brief  Default UART options (used for the fields of platform instance that
+ *         are 0)
+ * @note   Rx buffer size must be greater than UART_FIFO_LEN (128).
+ */
+#define YX5300_UART_BAUD              9600
+#define YX5300_UART_RX_BUFFER_SIZE    256
+#define YX5300_UART_TX_BUFFER_SIZE    256
+
+/**
+ * @brief  Baud rates that are tried by auto-baud probe (AutoBaud of platform
+ *         instance), from the highest to the lowest
+ * @note   The probe sends a status query at each rate and waits for the reply
+ *         up to YX5300_AUTO_BAUD_TIMEOUT ms.
+ */
+#define YX5300_AUTO_BAUD_LIST     {115200, 57600, 38400, 19200}
+#define YX5300_AUTO_BAUD_TIMEOUT  50  // ms
+
+/**
+ * @brief  Specify whether a task is created to receive the responses of module
+ *         - 0: User must pass the received data to YX5300_Rx or YX5300_RxBuffer.
+ *         - 1: A task waits on the UART event queue and passes each received
+ *              frame to YX5300_RxBuffer. The end byte of frames (0xEF) is
+ *              detected by UART pattern detection, so the task wakes up once
+ *              per frame instead of once per byte.
+ */
+#define YX5300_RX_TASK_ENABLE     0
+#define YX5300_RX_TASK_STACK      2048
+#define YX5300_RX_TASK_PRIORITY   10
+
+/**
+ * @brief  Options of the task that processes a group of handlers
+ *         (YX5300_Platform_StartGroupTask)
+ * @note   YX5300_RX_TASK_ENABLE must be 0, so the group task reads the UARTs.
+ */
+#define YX5300_GROUP_TASK_STACK     3072
+#define YX5300_GROUP_TASK_PRIORITY  10
+#define YX5300_GROUP_TASK_PERIOD    10  // ms
+
+/**
+ * @brief  NVS namespace of media library snapshots
+ *         (YX5300_Platform_LibrarySave/YX5300_Platform_LibraryLoad)
+ */
+#define YX5300_NVS_NAMESPACE        "yx5300"
+
+
+
+/* Exported Data Types ----------------------------------------------------------*/
+/**
+ * @brief  Platform instance data type
+ * @note   User must initialize UartNum, TxGpio and RxGpio. Baud, buffer sizes,
+ *         AutoBaud and NonBlockingSend are optional. Other fields are used by
+ *         platform dependent layer.
+ * @note   The instance must remain valid while the handler is in use.
+ */
+typedef struct YX5300_Platform_Port_s
+{
+  uart_port_t UartNum;
+  gpio_num_t  TxGpio;
+  gpio_num_t  RxGpio;
+  uint32_t    Baud;          // 0: YX5300_UART_BAUD
+  uint16_t    RxBufferSize;  // 0: YX5300_UART_RX_BUFFER_SIZE
+  uint16_t    TxBufferSize;  // 0: YX5300_UART_TX_BUFFER_SIZE
+  // 0: Baud is used.
+  // 1: The rates of YX5300_AUTO_BAUD_LIST that are higher than Baud are probed
+  //    at initialization and the highest one that the module answers is used.
+  //    If none of them is answered, Baud is used. Baud is updated to the rate
+  //    in use. The module must be ready (powered up) before YX5300_Init.
+  uint8_t     AutoBaud;
+  // 0: Send waits for the previous data to be transmitted completely.
+  // 1: Send only copies data into UART Tx ring buffer and returns. It fails if
+  //    there is not enough free space in the buffer.
+  uint8_t     NonBlockingSend;
+
+  YX5300_Handler_t *Handler;
+  QueueHandle_t EventQueue;
+  TaskHandle_t  RxTask;
+  portMUX_TYPE  Lock;
+} YX5300_Platform_Port_t;
+
 
 
 /**
@@ -57,11 +146,87 @@ extern "C" {
 
 /**
  * @brief  Initialize platform device to communicate YX5300.
+ * @note   Each module must have its own handler and platform instance.
  * @param  Handler: Pointer to handler
+ * @param  Port: Pointer to platform instance (UART and pins). If it is NULL, the
+ *               default instance (YX5300_UART_NUM, YX5300_UART_TXD_GPIO and
+ *               YX5300_UART_RXD_GPIO) is used.
  * @retval None
  */
 void
-YX5300_Platform_Init(YX5300_Handler_t *Handler);
+YX5300_Platform_Init(YX5300_Handler_t *Handler, YX5300_Platform_Port_t *Port);
+
+
+/**
+ * @brief  Check whether all sent data is transmitted completely.
+ * @note   The UART driver does not report Tx completion through its event
+ *         queue, so the Tx done state of driver is read without waiting.
+ * @param  Handler: Pointer to handler initialized by YX5300_Platform_Init
+ * @retval 
+ *         -  1: All data is transmitted.
+ *         -  0: Transmission is in progress.
+ */
+int8_t
+YX5300_Platform_TxDone(YX5300_Handler_t *Handler);
+
+
+/**
+ * @brief  Wait for all sent data to be transmitted completely.
+ * @note   The task is blocked until the Tx done interrupt of UART (no busy
+ *         wait).
+ * @param  Handler: Pointer to handler initialized by YX5300_Platform_Init
+ * @param  Timeout: Maximum time to wait in ms
+ * @retval 
+ *         -  0: All data is transmitted.
+ *         - -1: Timeout expired.
+ */
+int8_t
+YX5300_Platform_Flush(YX5300_Handler_t *Handler, uint16_t Timeout);
+
+
+#if (YX5300_USE_GROUP)
+/**
+ * @brief  Create a task that processes a group of handlers.
+ * @note   The task calls YX5300_GroupProcess every YX5300_GROUP_TASK_PERIOD ms.
+ *         So one task serves all modules instead of one task per module.
+ * @param  Group: Pointer to group initialized by YX5300_GroupInit
+ * @param  Task: Pointer to store the task handle (can be NULL)
+ * @retval 
+ *         -  0: The operation was successful.
+ *         - -1: The operation failed. 
+ */
+int8_t
+YX5300_Platform_StartGroupTask(YX5300_Group_t *Group, TaskHandle_t *Task);
+#endif
+
+
+#if (YX5300_USE_LIBRARY)
+/**
+ * @brief  Store the media library index of handler in NVS.
+ * @note   NVS must be initialized by nvs_flash_init. The snapshot of each
+ *         instance is stored with its own key based on UART number.
+ * @param  Handler: Pointer to handler initialized by YX5300_Platform_Init
+ * @retval 
+ *         -  0: The operation was successful.
+ *         - -1: The operation failed. 
+ */
+int8_t
+YX5300_Platform_LibrarySave(YX5300_Handler_t *Handler);
+
+
+/**
+ * @brief  Load the media library index of handler from NVS.
+ * @note   Call this function after YX5300_LibrarySetBuffer and before
+ *         YX5300_Init. If the total number of tracks reported by the module
+ *         matches the snapshot, the folders are not scanned again.
+ * @param  Handler: Pointer to handler initialized by YX5300_Platform_Init
+ * @retval 
+ *         -  0: The operation was successful.
+ *         - -1: The operation failed (e.g. no snapshot is stored). 
+ */
+int8_t
+YX5300_Platform_LibraryLoad(YX5300_Handler_t *Handler);
+#endif
 
 
 
@@ -0,0 +1,320 @@
+/**
+ **********************************************************************************
+ * @file   YX5300_benchmark.c
+ * @author Hossein.M (https://github.com/Hossein-M98)
+ * @brief  Latency and throughput benchmark of YX5300 Driver on the host emulator
+ * @note   Build and run from the root of repository:
+ *         gcc -O2 -Isrc/include -Iport/POSIX -DYX5300_USE_TX_QUEUE=1
+ *             src/YX5300.c port/POSIX/YX5300_platform.c
+ *             port/POSIX/YX5300_benchmark.c -o yx5300_benchmark
+ *         ./yx5300_benchmark
+ * @note   All results except the parser speed are measured on the virtual clock
+ *         of emulator, so they show the protocol cost and not the host speed.
+ **********************************************************************************
+ *
+ * Copyright (c) 2024 Mahda Embedded System (MIT License)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ **********************************************************************************
+ */
+
+/* Includes ---------------------------------------------------------------------*/
+#define _POSIX_C_SOURCE 199309L
+#include "YX5300.h"
+#include "YX5300_platform.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+
+/* Private Constants ------------------------------------------------------------*/
+#define BENCH_COMMANDS        500
+#define BENCH_POLL_TIME       1000   // us
+#define BENCH_PARSER_FRAMES   100000
+#define BENCH_NOISE_PPM       2000
+#define BENCH_ACK_JITTER      20     // ms
+
+#if !(YX5300_USE_EVENTS)
+#error "YX5300_benchmark.c requires YX5300_USE_EVENTS (ACKs are timed by events)"
+#endif
+
+
+
+/* Private Variables ------------------------------------------------------------*/
+static uint64_t Bench_SendTime;
+static uint64_t Bench_AckTime;
+static uint32_t Bench_Latency[BENCH_COMMANDS];
+static uint32_t Bench_LatencyCount;
+static uint32_t Bench_Acks;
+static uint32_t Bench_Frames;
+static int8_t (*Bench_Send)(void *UserCtx, uint8_t *Data, uint8_t Len);
+static YX5300_Handler_t *Bench_Handler;
+
+
+
+/**
+ ==================================================================================
+                           ##### Private Functions #####
+ ==================================================================================
+ */
+
+static int8_t
+Bench_SendHook(void *UserCtx, uint8_t *Data, uint8_t Len)
+{
+  Bench_SendTime = YX5300_Platform_GetTimeUs(Bench_Handler);
+  Bench_Frames += Len / YX5300_FRAME_SIZE;
+  return Bench_Send(UserCtx, Data, Len);
+}
+
+
+static void
+Bench_Event(YX5300_Handler_t *Handler, const YX5300_Event_t *Event)
+{
+  if (Event->Type != YX5300_EVENT_ACK)
+    return;
+
+  Bench_Acks++;
+  Bench_AckTime = YX5300_Platform_GetTimeUs(Handler);
+  if (Bench_LatencyCount < BENCH_COMMANDS)
+    Bench_Latency[Bench_LatencyCount++] =
+      (uint32_t)(YX5300_Platform_GetTimeUs(Handler) - Bench_SendTime);
+}
+
+
+static void
+Bench_Poll(YX5300_Handler_t *Handler)
+{
+  uint8_t Buffer[YX5300_RESPONSE_SIZE];
+  uint8_t Len = 0;
+
+  YX5300_Platform_Advance(Handler, BENCH_POLL_TIME);
+  do
+  {
+    Handler->Platform.Receive(Handler->Platform.UserCtx,
+                              Buffer, sizeof(Buffer), &Len);
+    YX5300_RxBuffer(Handler, Buffer, Len, NULL);
+  } while (Len != 0);
+
+  YX5300_Process(Handler);
+}
+
+
+static int
+Bench_Compare(const void *A, const void *B)
+{
+  uint32_t a = *(const uint32_t *)A;
+  uint32_t b = *(const uint32_t *)B;
+  return (a > b) - (a < b);
+}
+
+
+static uint32_t
+Bench_Percentile(uint32_t Percent)
+{
+  uint32_t Index = 0;
+
+  if (Bench_LatencyCount == 0)
+    return 0;
+
+  Index = (Bench_LatencyCount * Percent + 99) / 100;
+  if (Index > 0)
+    Index--;
+  return Bench_Latency[Index];
+}
+
+
+static uint8_t
+Bench_Setup(YX5300_Handler_t *Handler, YX5300_Platform_Port_t *Port,
+            uint32_t NoisePpm)
+{
+  uint64_t Start = 0;
+
+  memset(Handler, 0, sizeof(*Handler));
+  memset(Port, 0, sizeof(*Port));
+  Port->NoisePpm = NoisePpm;
+  Port->AckJitter = BENCH_ACK_JITTER;
+
+  YX5300_Platform_Init(Handler, Port);
+  Bench_Handler = Handler;
+  Bench_Send = Handler->Platform.Send;
+  Handler->Platform.Send = Bench_SendHook;
+
+  Start = YX5300_Platform_GetTimeUs(Handler);
+  if (YX5300_Init(Handler) != YX5300_OK)
+  {
+    printf("  Init failed\r\n");
+    return 1;
+  }
+  printf("  Init boot time:      %8.1f ms\r\n",
+         (YX5300_Platform_GetTimeUs(Handler) - Start) / 1000.0);
+
+  YX5300_SetFeedback(Handler, YX5300_FEEDBACK_ENABLE);
+  YX5300_SetEventCallback(Handler, Bench_Event);
+  return 0;
+}
+
+
+static void
+Bench_Throughput(uint32_t NoisePpm)
+{
+  YX5300_Handler_t Handler;
+  YX5300_Platform_Port_t Port;
+  uint64_t Start = 0;
+  uint64_t Time = 0;
+  uint32_t Sent = 0;
+  uint32_t Frames = 0;
+  uint32_t Received = 0;
+  uint32_t Executed = 0;
+  uint32_t Corrupted = 0;
+  uint32_t i = 0;
+
+  printf("Command throughput (noise %u ppm)\r\n", (unsigned)NoisePpm);
+  if (Bench_Setup(&Handler, &Port, NoisePpm) != 0)
+    return;
+
+  Bench_LatencyCount = 0;
+  Bench_Acks = 0;
+  Frames = Bench_Frames;
+  Received = Port.CommandsReceived;
+  Executed = Port.CommandsReceived - Port.CommandsDropped;
+  Corrupted = Port.FramesCorrupted;
+  Start = YX5300_Platform_GetTimeUs(&Handler);
+
+  for (i = 0; i < BENCH_COMMANDS; i++)
+  {
+    // Alternate two volume levels, so no command is skipped by the cache
+    while (YX5300_SetVolume(&Handler, (i & 1) ? 20 : 10) == YX5300_QUEUE_FULL)
+      Bench_Poll(&Handler);
+    Sent++;
+
+#if (YX5300_USE_TX_QUEUE)
+    // Next call is made after this command is sent (while its ACK is awaited),
+    // so YX5300_USE_TX_COALESCE does not merge the calls
+    while (Handler.Tx.Count != 0)
+      Bench_Poll(&Handler);
+#else
+    // Without the queue, next command is sent after the ACK (or a timeout)
+    {
+      uint32_t Acks = Bench_Acks;
+      uint32_t Wait = 0;
+      while (Bench_Acks == Acks && Wait++ < YX5300_TX_ACK_TIMEOUT)
+        Bench_Poll(&Handler);
+    }
+#endif
+  }
+
+  // Drain the queue and the last ACK
+  for (i = 0; i < 1000; i++)
+    Bench_Poll(&Handler);
+
+  // Throughput counts the commands that the module executed (until the last
+  // ACK), not the calls
+  Time = Bench_AckTime - Start;
+  Frames = Bench_Frames - Frames;
+  Received = Port.CommandsReceived - Received;
+  Executed = Port.CommandsReceived - Port.CommandsDropped - Executed;
+  Corrupted = Port.FramesCorrupted - Corrupted;
+  qsort(Bench_Latency, Bench_LatencyCount, sizeof(uint32_t), Bench_Compare);
+
+  printf("  Calls:               %8u\r\n", (unsigned)Sent);
+  printf("  Frames sent:         %8u (including retries)\r\n", (unsigned)Frames);
+  printf("  Commands:            %8u (%u received, %u dropped, %u corrupted)\r\n",
+         (unsigned)Executed, (unsigned)Received,
+         (unsigned)(Received - Executed), (unsigned)Corrupted);
+  printf("  Throughput:          %8.1f commands/s\r\n",
+         Time ? Executed * 1000000.0 / Time : 0.0);
+  printf("  ACKs:                %8u\r\n", (unsigned)Bench_Acks);
+  printf("  ACK latency p50:     %8.2f ms\r\n", Bench_Percentile(50) / 1000.0);
+  printf("  ACK latency p90:     %8.2f ms\r\n", Bench_Percentile(90) / 1000.0);
+  printf("  ACK latency p99:     %8.2f ms\r\n", Bench_Percentile(99) / 1000.0);
+  printf("  ACK latency max:     %8.2f ms\r\n", Bench_Percentile(100) / 1000.0);
+}
+
+
+static double
+Bench_Elapsed(const struct timespec *Start, const struct timespec *End)
+{
+  return (End->tv_sec - Start->tv_sec) * 1e9 + (End->tv_nsec - Start->tv_nsec);
+}
+
+
+static void
+Bench_Parser(void)
+{
+  static const uint8_t Frame[YX5300_RESPONSE_SIZE] =
+    {0x7E, 0xFF, 0x06, 0x4C, 0x00, 0x00, 0x05, 0xFE, 0xAA, 0xEF};
+  static uint8_t Buffer[BENCH_PARSER_FRAMES * YX5300_RESPONSE_SIZE];
+  YX5300_Handler_t Handler;
+  struct timespec Start, End;
+  uint32_t Frames = 0;
+  uint32_t Index = 0;
+  uint16_t Count = 0;
+  uint16_t Len = 0;
+  uint32_t i = 0;
+  double Time = 0;
+
+  printf("Parser speed (host clock)\r\n");
+
+  for (i = 0; i < BENCH_PARSER_FRAMES; i++)
+    memcpy(&Buffer[i * YX5300_RESPONSE_SIZE], Frame, YX5300_RESPONSE_SIZE);
+
+  memset(&Handler, 0, sizeof(Handler));
+
+  clock_gettime(CLOCK_MONOTONIC, &Start);
+  for (i = 0; i < sizeof(Buffer); i++)
+    if (YX5300_Rx(&Handler, Buffer[i]) == YX5300_RX_COMPLETE)
+      Frames++;
+  clock_gettime(CLOCK_MONOTONIC, &End);
+  Time = Bench_Elapsed(&Start, &End);
+  printf("  YX5300_Rx:           %8.2f ns/byte (%u frames)\r\n",
+         Time / sizeof(Buffer), (unsigned)Frames);
+
+  Frames = 0;
+  clock_gettime(CLOCK_MONOTONIC, &Start);
+  for (Index = 0; Index < sizeof(Buffer); Index += Len)
+  {
+    Len = (sizeof(Buffer) - Index > 0xFFFF) ? 0xFFFF : (uint16_t)(sizeof(Buffer) - Index);
+    YX5300_RxBuffer(&Handler, &Buffer[Index], Len, &Count);
+    Frames += Count;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &End);
+  Time = Bench_Elapsed(&Start, &End);
+  printf("  YX5300_RxBuffer:     %8.2f ns/byte (%u frames)\r\n",
+         Time / sizeof(Buffer), (unsigned)Frames);
+}
+
+
+
+/**
+ ==================================================================================
+                            ##### Public Functions #####
+ ==================================================================================
+ */
+
+int
+main(void)
+{
+  Bench_Throughput(0);
+  Bench_Throughput(BENCH_NOISE_PPM);
+  Bench_Parser();
+  return 0;
+}
@@ -0,0 +1,605 @@
+/**
+ **********************************************************************************
+ * @file   YX5300_platform.c
+ * @author Hossein.M (https://github.com/Hossein-M98)
+ * @brief  A host (POSIX) platform dependent layer for YX5300 Driver, connected
+ *         to a software emulator of the module
+ **********************************************************************************
+ *
+ * Copyright (c) 2024 Mahda Embedded System (MIT License)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ **********************************************************************************
+ */
+
+/* Includes ---------------------------------------------------------------------*/
+#include "YX5300_platform.h"
+#include <string.h>
+
+
+
+/* Private Constants ------------------------------------------------------------*/
+#define YX5300_EMU_FRAME_SIZE     10
+#define YX5300_EMU_RX_MASK        (YX5300_EMU_RX_SIZE - 1)
+
+#if (YX5300_EMU_RX_SIZE & YX5300_EMU_RX_MASK)
+#error "YX5300_EMU_RX_SIZE must be a power of 2"
+#endif
+
+
+
+/* Private Variables ------------------------------------------------------------*/
+static YX5300_Platform_Port_t Platform_DefaultPort;
+
+
+
+/**
+ ==================================================================================
+                         ##### Emulator Functions #####
+ ==================================================================================
+ */
+
+static inline uint64_t
+Emulator_ByteTime(YX5300_Platform_Port_t *Port)
+{
+  // 1 start bit, 8 data bits and 1 stop bit
+  return 10000000ULL / Port->Baud;
+}
+
+
+static uint32_t
+Emulator_Random(YX5300_Platform_Port_t *Port)
+{
+  uint32_t x = Port->Random;
+
+  // xorshift32
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  Port->Random = x;
+  return x;
+}
+
+
+static uint8_t
+Emulator_Noise(YX5300_Platform_Port_t *Port, uint8_t Byte)
+{
+  uint32_t x = 0;
+
+  if (Port->NoisePpm == 0)
+    return Byte;
+
+  x = Emulator_Random(Port);
+  if ((x % 1000000) >= Port->NoisePpm)
+    return Byte;
+
+  Port->BytesCorrupted++;
+  return Byte ^ (uint8_t)(1 << ((x >> 20) & 0x07));
+}
+
+
+static void
+Emulator_Schedule(YX5300_Platform_Port_t *Port,
+                  uint64_t Time, uint8_t Code, uint16_t Data)
+{
+  if (Port->EventCount >= YX5300_EMU_EVENT_COUNT)
+    return;
+
+  Port->Events[Port->EventCount].Time = Time;
+  Port->Events[Port->EventCount].Code = Code;
+  Port->Events[Port->EventCount].Data = Data;
+  Port->EventCount++;
+}
+
+
+static void
+Emulator_SendFrame(YX5300_Platform_Port_t *Port,
+                   uint64_t Time, uint8_t Code, uint16_t Data)
+{
+  uint8_t Frame[YX5300_EMU_FRAME_SIZE];
+  uint64_t ByteTime = Emulator_ByteTime(Port);
+  uint16_t Sum = 0;
+  uint8_t i = 0;
+
+  // Response Structure  0x7E 0xFF 0x06 RSP 0x00 DATH DATL CHKH CHKL 0xEF
+  Frame[0] = 0x7E;
+  Frame[1] = 0xFF;
+  Frame[2] = 0x06;
+  Frame[3] = Code;
+  Frame[4] = 0x00;
+  Frame[5] = (uint8_t)(Data >> 8);
+  Frame[6] = (uint8_t)(Data & 0xFF);
+  for (i = 1; i <= 6; i++)
+    Sum += Frame[i];
+  Sum = 0 - Sum;
+  Frame[7] = (uint8_t)(Sum >> 8);
+  Frame[8] = (uint8_t)(Sum & 0xFF);
+  Frame[9] = 0xEF;
+
+  if (Port->ModuleTxFree > Time)
+    Time = Port->ModuleTxFree;
+
+  for (i = 0; i < YX5300_EMU_FRAME_SIZE; i++)
+  {
+    if (((Port->Rx.Head + 1) & YX5300_EMU_RX_MASK) == Port->Rx.Tail)
+      break;
+    Time += ByteTime;
+    Port->Rx.Data[Port->Rx.Head] = Emulator_Noise(Port, Frame[i]);
+    Port->Rx.Time[Port->Rx.Head] = Time;
+    Port->Rx.Head = (Port->Rx.Head + 1) & YX5300_EMU_RX_MASK;
+  }
+
+  Port->ModuleTxFree = Time;
+}
+
+
+static void
+Emulator_Play(YX5300_Platform_Port_t *Port, uint64_t Time, uint16_t Track)
+{
+  Port->Track = Track;
+  Port->State = 0x01;
+  Port->TrackEnd = Time + (uint64_t)Port->TrackLength * 1000;
+}
+
+
+static uint16_t
+Emulator_TotalTracks(YX5300_Platform_Port_t *Port)
+{
+  return (uint16_t)Port->Folders * Port->FolderFiles;
+}
+
+
+static void
+Emulator_Complete(YX5300_Platform_Port_t *Port)
+{
+  uint64_t Time = Port->TrackEnd;
+  uint16_t Track = Port->Track;
+  uint16_t First = 0;
+
+  // The module sends the completed play response twice
+  Emulator_SendFrame(Port, Time, 0x3D, Track);
+  Emulator_SendFrame(Port, Time, 0x3D, Track);
+
+  switch (Port->Cycle)
+  {
+  case 1:
+    Emulator_Play(Port, Time, Track);
+    break;
+
+  case 2:
+    First = ((Track - 1) / Port->FolderFiles) * Port->FolderFiles + 1;
+    Track = (Track + 1 - First < Port->FolderFiles) ? Track + 1 : First;
+    Emulator_Play(Port, Time, Track);
+    break;
+
+  default:
+    Port->State = 0x00;
+    Port->Track = 0;
+    break;
+  }
+}
+
+
+static void
+Emulator_Command(YX5300_Platform_Port_t *Port, uint64_t Time,
+                 uint8_t Command, uint8_t Feedback, uint16_t Data)
+{
+  uint64_t Ack = Time + (uint64_t)Port->AckDelay * 1000;
+  uint16_t Total = Emulator_TotalTracks(Port);
+  uint8_t DataH = (uint8_t)(Data >> 8);
+  uint8_t DataL = (uint8_t)(Data & 0xFF);
+  uint8_t Error = 0;
+
+  if (Port->AckJitter != 0)
+    Ack += Emulator_Random(Port) % ((uint32_t)Port->AckJitter * 1000 + 1);
+
+  switch (Command)
+  {
+  case 0x01: // Next
+    Emulator_Play(Port, Ack, (Port->Track < Total) ? Port->Track + 1 : 1);
+    break;
+
+  case 0x02: // Previous
+    Emulator_Play(Port, Ack, (Port->Track > 1) ? Port->Track - 1 : Total);
+    break;
+
+  case 0x03: // Play with index
+  case 0x08: // Single cycle play
+    if (Data == 0 || Data > Total)
+    {
+      Error = 1;
+      break;
+    }
+    Port->Cycle = (Command == 0x08) ? 1 : 0;
+    Emulator_Play(Port, Ack, Data);
+    break;
+
+  case 0x04: // Volume up
+    if (Port->Volume < 30)
+      Port->Volume++;
+    break;
+
+  case 0x05: // Volume down
+    if (Port->Volume > 0)
+      Port->Volume--;
+    break;
+
+  case 0x06: // Set volume
+    Port->Volume = (DataL > 30) ? 30 : DataL;
+    break;
+
+  case 0x0A: // Sleep
+    Port->Sleep = 1;
+    break;
+
+  case 0x0B: // Wake up
+    Port->Sleep = 0;
+    break;
+
+  case 0x0C: // Reset
+    Port->State = 0x00;
+    Port->Track = 0;
+    Port->Volume = 30;
+    Port->Cycle = 0;
+    Port->EventCount = 0;
+    Emulator_Schedule(Port, Time + (uint64_t)Port->InitTime * 1000, 0x3F, 0x02);
+    break;
+
+  case 0x0D: // Play
+    if (Port->State == 0x02)
+    {
+      Port->State = 0x01;
+      Port->TrackEnd = Ack + Port->TrackRemain;
+    }
+    else if (Port->State == 0x00)
+    {
+      Emulator_Play(Port, Ack, Port->Track ? Port->Track : 1);
+    }
+    break;
+
+  case 0x0E: // Pause
+    if (Port->State == 0x01)
+    {
+      Port->State = 0x02;
+      Port->TrackRemain = (Port->TrackEnd > Ack) ? Port->TrackEnd - Ack : 0;
+    }
+    break;
+
+  case 0x0F: // Play folder file
+  case 0x17: // Cycle play folder
+    if (DataH == 0 || DataH > Port->Folders || DataL > Port->FolderFiles ||
+        (Command == 0x0F && DataL == 0))
+    {
+      Error = 1;
+      break;
+    }
+    Port->Cycle = (Command == 0x17) ? 2 : 0;
+    Emulator_Play(Port, Ack, (DataH - 1) * Port->FolderFiles + (DataL ? DataL : 1));
+    break;
+
+  case 0x16: // Stop
+    Port->State = 0x00;
+    Port->Track = 0;
+    Port->Cycle = 0;
+    break;
+
+  case 0x19: // Set single cycle
+    Port->Cycle = (DataL == 0x00) ? 1 : 0;
+    break;
+
+  case 0x22: // Play with volume
+    if (DataL == 0 || DataL > Total)
+    {
+      Error = 1;
+      break;
+    }
+    Port->Volume = (DataH > 30) ? 30 : DataH;
+    Port->Cycle = 0;
+    Emulator_Play(Port, Ack, DataL);
+    break;
+
+  case 0x09: // Select device
+  case 0x1A: // Set DAC
+  case 0x42: // Query status
+  case 0x43: // Query volume
+  case 0x48: // Query total tracks
+  case 0x4C: // Query playing track
+  case 0x4F: // Query folder count
+    break;
+
+  case 0x4E: // Query folder tracks
+    if (DataL == 0 || DataL > Port->Folders)
+      Error = 1;
+    break;
+
+  default:
+    Error = 1;
+    break;
+  }
+
+  if (Error)
+  {
+    Emulator_Schedule(Port, Ack, 0x40, 0x06);
+    return;
+  }
+
+  if (Feedback)
+    Emulator_Schedule(Port, Ack, 0x41, 0x00);
+
+  switch (Command)
+  {
+  case 0x42: Emulator_Schedule(Port, Ack, 0x42, Port->State); break;
+  case 0x43: Emulator_Schedule(Port, Ack, 0x43, Port->Volume); break;
+  case 0x48: Emulator_Schedule(Port, Ack, 0x48, Total); break;
+  case 0x4C: Emulator_Schedule(Port, Ack, 0x4C, Port->Track); break;
+  case 0x4E: Emulator_Schedule(Port, Ack, 0x4E, Port->FolderFiles); break;
+  case 0x4F: Emulator_Schedule(Port, Ack, 0x4F, Port->Folders); break;
+  default: break;
+  }
+}
+
+
+static void
+Emulator_Receive(YX5300_Platform_Port_t *Port, uint64_t Time, const uint8_t *Frame,
+                 uint8_t Len)
+{
+  uint16_t Sum = 0;
+  uint8_t i = 0;
+
+  // Frame Structure  0x7E VER LEN CMD FBK DAT1 DAT2 [CHKH CHKL] 0xEF
+  if (Len < 8 || Frame[0] != 0x7E || Frame[1] != 0xFF || Frame[2] != 0x06 ||
+      Frame[Len - 1] != 0xEF || (Len != 8 && Len != 10))
+  {
+    Port->FramesCorrupted++;
+    return;
+  }
+
+  if (Len == 10)
+  {
+    for (i = 1; i <= 6; i++)
+      Sum += Frame[i];
+    if ((uint16_t)(0 - Sum) != ((Frame[7] << 8) | Frame[8]))
+    {
+      Port->FramesCorrupted++;
+      return;
+    }
+  }
+
+  Port->CommandsReceived++;
+
+  if (Time < Port->BusyUntil)
+  {
+    Port->CommandsDropped++;
+    return;
+  }
+  Port->BusyUntil = Time + (uint64_t)Port->BusyTime * 1000;
+
+  Emulator_Command(Port, Time, Frame[3], Frame[4], (Frame[5] << 8) | Frame[6]);
+}
+
+
+static void
+Emulator_Run(YX5300_Platform_Port_t *Port)
+{
+  uint8_t Index = 0;
+  uint8_t i = 0;
+
+  for (;;)
+  {
+    // Earliest event that is due (the completed play is an event too)
+    Index = YX5300_EMU_EVENT_COUNT;
+    for (i = 0; i < Port->EventCount; i++)
+    {
+      if (Port->Events[i].Time <= Port->Now &&
+          (Index == YX5300_EMU_EVENT_COUNT ||
+           Port->Events[i].Time < Port->Events[Index].Time))
+        Index = i;
+    }
+
+    if (Port->State == 0x01 && Port->TrackEnd <= Port->Now &&
+        (Index == YX5300_EMU_EVENT_COUNT ||
+         Port->TrackEnd < Port->Events[Index].Time))
+    {
+      Emulator_Complete(Port);
+      continue;
+    }
+
+    if (Index == YX5300_EMU_EVENT_COUNT)
+      break;
+
+    Emulator_SendFrame(Port, Port->Events[Index].Time,
+                       Port->Events[Index].Code, Port->Events[Index].Data);
+    Port->EventCount--;
+    Port->Events[Index] = Port->Events[Port->EventCount];
+  }
+}
+
+
+
+/**
+ ==================================================================================
+                           ##### Private Functions #####
+ ==================================================================================
+ */
+
+static int8_t
+Platform_Init(void *UserCtx)
+{
+  YX5300_Platform_Port_t *Port = (YX5300_Platform_Port_t *)UserCtx;
+
+  if (Port->Baud == 0)        Port->Baud = YX5300_EMU_BAUD;
+  if (Port->AckDelay == 0)    Port->AckDelay = YX5300_EMU_ACK_DELAY;
+  if (Port->BusyTime == 0)    Port->BusyTime = YX5300_EMU_BUSY_TIME;
+  if (Port->InitTime == 0)    Port->InitTime = YX5300_EMU_INIT_TIME;
+  if (Port->TrackLength == 0) Port->TrackLength = YX5300_EMU_TRACK_LENGTH;
+  if (Port->Folders == 0)     Port->Folders = YX5300_EMU_FOLDERS;
+  if (Port->FolderFiles == 0) Port->FolderFiles = YX5300_EMU_FOLDER_FILES;
+  if (Port->Seed == 0)        Port->Seed = 1;
+
+  Port->Random = Port->Seed;
+  Port->Volume = 30;
+
+  // Power on
+  Emulator_Schedule(Port, Port->Now + (uint64_t)Port->InitTime * 1000, 0x3F, 0x02);
+  return 0;
+}
+
+static int8_t
+Platform_DeInit(void *UserCtx)
+{
+  (void)UserCtx;
+  return 0;
+}
+
+static int8_t
+Platform_Delay(void *UserCtx, uint16_t Delay)
+{
+  YX5300_Platform_Port_t *Port = (YX5300_Platform_Port_t *)UserCtx;
+
+  Port->Now += (uint64_t)Delay * 1000;
+  Emulator_Run(Port);
+  return 0;
+}
+
+static int8_t
+Platform_Send(void *UserCtx, uint8_t *Data, uint8_t Len)
+{
+  YX5300_Platform_Port_t *Port = (YX5300_Platform_Port_t *)UserCtx;
+  uint8_t Frame[YX5300_EMU_FRAME_SIZE];
+  uint64_t Time = Port->Now;
+  uint8_t Size = Len;
+  uint8_t Index = 0;
+  uint8_t i = 0;
+
+  // A batch contains several frames that are sent with a gap
+  if (Len > sizeof(Frame))
+  {
+    if (Len % YX5300_FRAME_SIZE != 0)
+      return -1;
+    Size = YX5300_FRAME_SIZE;
+  }
+
+  if (Port->HostTxFree > Time)
+    Time = Port->HostTxFree;
+
+  for (Index = 0; Index < Len; Index += Size)
+  {
+    if (Index != 0)
+      Time += (uint64_t)YX5300_BATCH_GAP * 1000;
+
+    // UART sends the bytes one after another
+    Time += Emulator_ByteTime(Port) * Size;
+    Port->HostTxFree = Time;
+
+    for (i = 0; i < Size; i++)
+      Frame[i] = Emulator_Noise(Port, Data[Index + i]);
+
+    Emulator_Receive(Port, Time, Frame, Size);
+  }
+
+  Emulator_Run(Port);
+  return 0;
+}
+
+static int8_t
+Platform_Receive(void *UserCtx, uint8_t *Data, uint8_t Size, uint8_t *Len)
+{
+  YX5300_Platform_Port_t *Port = (YX5300_Platform_Port_t *)UserCtx;
+  uint8_t Count = 0;
+
+  Emulator_Run(Port);
+
+  while (Count < Size && Port->Rx.Tail != Port->Rx.Head &&
+         Port->Rx.Time[Port->Rx.Tail] <= Port->Now)
+  {
+    Data[Count++] = Port->Rx.Data[Port->Rx.Tail];
+    Port->Rx.Tail = (Port->Rx.Tail + 1) & YX5300_EMU_RX_MASK;
+  }
+
+  *Len = Count;
+  return 0;
+}
+
+static uint32_t
+Platform_GetTick(void *UserCtx)
+{
+  YX5300_Platform_Port_t *Port = (YX5300_Platform_Port_t *)UserCtx;
+  return (uint32_t)(Port->Now / 1000);
+}
+
+
+
+/**
+ ==================================================================================
+                            ##### Public Functions #####
+ ==================================================================================
+ */
+
+/**
+ * @brief  Initialize platform device and emulator of YX5300.
+ * @param  Handler: Pointer to handler
+ * @param  Port: Pointer to platform instance. If it is NULL, a default instance
+ *               is used.
+ * @retval None
+ */
+void
+YX5300_Platform_Init(YX5300_Handler_t *Handler, YX5300_Platform_Port_t *Port)
+{
+  if (Port == NULL)
+    Port = &Platform_DefaultPort;
+
+  YX5300_PLATFORM_LINK_USERCTX(Handler, Port);
+  YX5300_PLATFORM_LINK_INIT(Handler, Platform_Init);
+  YX5300_PLATFORM_LINK_DEINIT(Handler, Platform_DeInit);
+  YX5300_PLATFORM_LINK_DELAY(Handler, Platform_Delay);
+  YX5300_PLATFORM_LINK_SEND(Handler, Platform_Send);
+  YX5300_PLATFORM_LINK_RECEIVE(Handler, Platform_Receive);
+  YX5300_PLATFORM_LINK_GETTICK(Handler, Platform_GetTick);
+}
+
+
+/**
+ * @brief  Let the virtual time pass without calling Delay.
+ * @param  Handler: Pointer to handler initialized by YX5300_Platform_Init
+ * @param  Time: Time in us
+ * @retval None
+ */
+void
+YX5300_Platform_Advance(YX5300_Handler_t *Handler, uint32_t Time)
+{
+  YX5300_Platform_Port_t *Port = (YX5300_Platform_Port_t *)Handler->Platform.UserCtx;
+
+  Port->Now += Time;
+  Emulator_Run(Port);
+}
+
+
+/**
+ * @brief  Get the virtual time.
+ * @param  Handler: Pointer to handler initialized by YX5300_Platform_Init
+ * @retval Time since YX5300_Platform_Init in us
+ */
+uint64_t
+YX5300_Platform_GetTimeUs(YX5300_Handler_t *Handler)
+{
+  YX5300_Platform_Port_t *Port = (YX5300_Platform_Port_t *)Handler->Platform.UserCtx;
+
+  return Port->Now;
+}
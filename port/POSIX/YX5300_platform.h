@@ -0,0 +1,174 @@
+/**
+ **********************************************************************************
+ * @file   YX5300_platform.h
+ * @author Hossein.M (https://github.com/Hossein-M98)
+ * @brief  A host (POSIX) platform dependent layer for YX5300 Driver, connected
+ *         to a software emulator of the module
+ **********************************************************************************
+ *
+ * Copyright (c) 2024 Mahda Embedded System (MIT License)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ **********************************************************************************
+ */
+
+/* Define to prevent recursive inclusion ----------------------------------------*/
+#ifndef _YX5300_PLATFORM_H_
+#define _YX5300_PLATFORM_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Includes ---------------------------------------------------------------------*/
+#include "YX5300.h"
+#include <stdint.h>
+
+
+/* Functionality Options --------------------------------------------------------*/
+/**
+ * @brief  Default options of the emulated module (used for the fields of
+ *         platform instance that are 0)
+ */
+#define YX5300_EMU_BAUD           9600
+#define YX5300_EMU_ACK_DELAY      10    // ms
+#define YX5300_EMU_BUSY_TIME      20    // ms
+#define YX5300_EMU_INIT_TIME      200   // ms
+#define YX5300_EMU_TRACK_LENGTH   3000  // ms
+#define YX5300_EMU_FOLDERS        10
+#define YX5300_EMU_FOLDER_FILES   10
+
+/**
+ * @brief  Size of emulator buffers
+ */
+#define YX5300_EMU_EVENT_COUNT    32
+#define YX5300_EMU_RX_SIZE        1024
+
+
+
+/* Exported Data Types ----------------------------------------------------------*/
+/**
+ * @brief  Platform instance data type
+ * @note   The emulator runs on a virtual clock. Time only passes by calling
+ *         Delay (or YX5300_Platform_Advance), so the results do not depend on
+ *         the speed of host.
+ * @note   User may set the options (fields that are 0 get the default values)
+ *         and read the counters. Other fields are used by platform dependent
+ *         layer.
+ */
+typedef struct YX5300_Platform_Port_s
+{
+  // Options
+  uint32_t Baud;         // Baud rate of the emulated UART
+  uint16_t AckDelay;     // Time from receiving a command to its ACK in ms
+  uint16_t AckJitter;    // Maximum random time added to AckDelay in ms
+                         // (0: constant ACK delay)
+  uint16_t BusyTime;     // Commands received in this time after a command are
+                         // dropped by the module (ms)
+  uint16_t InitTime;     // Time from reset to init done response in ms
+  uint32_t TrackLength;  // Play time of each track in ms
+  uint32_t NoisePpm;     // Probability of corrupting each byte on the line in
+                         // parts per million (both directions)
+  uint32_t Seed;         // Seed of noise generator
+  uint8_t  Folders;
+  uint8_t  FolderFiles;  // Number of files in each folder
+
+  // Counters
+  uint32_t CommandsReceived;
+  uint32_t CommandsDropped;  // Dropped because the module was busy
+  uint32_t FramesCorrupted;  // Commands with broken frame (no response)
+  uint32_t BytesCorrupted;
+
+  // Emulator state
+  uint64_t Now;          // Virtual time in us
+  uint64_t HostTxFree;   // Time the host Tx line gets free in us
+  uint64_t ModuleTxFree; // Time the module Tx line gets free in us
+  uint64_t BusyUntil;
+  uint64_t TrackEnd;     // Time the playing track completes in us
+  uint64_t TrackRemain;  // Remaining time of the paused track in us
+  uint32_t Random;
+  uint16_t Track;
+  uint8_t  Volume;
+  uint8_t  State;        // 0x00: Stop, 0x01: Play, 0x02: Pause
+  uint8_t  Cycle;        // 0: None, 1: Single track, 2: Folder
+  uint8_t  Sleep;
+
+  struct
+  {
+    uint64_t Time;
+    uint16_t Data;
+    uint8_t  Code;
+  } Events[YX5300_EMU_EVENT_COUNT];
+  uint8_t EventCount;
+
+  struct
+  {
+    uint64_t Time[YX5300_EMU_RX_SIZE];
+    uint8_t  Data[YX5300_EMU_RX_SIZE];
+    uint16_t Head;
+    uint16_t Tail;
+  } Rx;
+} YX5300_Platform_Port_t;
+
+
+
+/**
+ ==================================================================================
+                               ##### Functions #####
+ ==================================================================================
+ */
+
+/**
+ * @brief  Initialize platform device and emulator of YX5300.
+ * @param  Handler: Pointer to handler
+ * @param  Port: Pointer to platform instance. If it is NULL, a default instance
+ *               is used.
+ * @retval None
+ */
+void
+YX5300_Platform_Init(YX5300_Handler_t *Handler, YX5300_Platform_Port_t *Port);
+
+
+/**
+ * @brief  Let the virtual time pass without calling Delay.
+ * @param  Handler: Pointer to handler initialized by YX5300_Platform_Init
+ * @param  Time: Time in us
+ * @retval None
+ */
+void
+YX5300_Platform_Advance(YX5300_Handler_t *Handler, uint32_t Time);
+
+
+/**
+ * @brief  Get the virtual time.
+ * @param  Handler: Pointer to handler initialized by YX5300_Platform_Init
+ * @retval Time since YX5300_Platform_Init in us
+ */
+uint64_t
+YX5300_Platform_GetTimeUs(YX5300_Handler_t *Handler);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //! _YX5300_PLATFORM_H_
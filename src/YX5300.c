@@ -30,47 +30,174 @@
 
 /* Includes ---------------------------------------------------------------------*/
 #include "YX5300.h"
-#include <stdio.h>
+#include <stddef.h>
 
 
 /* Private Constants ------------------------------------------------------------*/
 /**
- * @brief  Command bytes for the YX5300 MP3 module
- */
-#define YX5300_CMD_START_BYTE       0x7E
-#define YX5300_CMD_VERSION          0xFF
-#define YX5300_CMD_NOT_FEEDBACK     0x00
-#define YX5300_CMD_FEEDBACK         0x01
-#define YX5300_CMD_END_BYTE         0xEF
-
-/**
- * @brief  Commands for the YX5300 MP3 module
- */
-#define YX5300_CMD_NEXT               0x01
-#define YX5300_CMD_PREV               0x02
-#define YX5300_CMD_PLAY_INDEX         0x03
-#define YX5300_CMD_VOL_UP             0x04
-#define YX5300_CMD_VOL_DOWN           0x05
-#define YX5300_CMD_VOL_SET            0x06
-#define YX5300_CMD_SINGLE_CYCLE       0x08
-#define YX5300_CMD_SEL_DEV            0x09
-#define YX5300_CMD_SLEEP_MODE         0x0A
-#define YX5300_CMD_WAKE_UP            0x0B
-#define YX5300_CMD_RESET              0x0C
-#define YX5300_CMD_PLAY               0x0D
-#define YX5300_CMD_PAUSE              0x0E
-#define YX5300_CMD_PLAY_FOLD_FILE     0x0F
-#define YX5300_CMD_STOP               0x16
-#define YX5300_CMD_PLAY_CYCLE_FOLD    0x17
-#define YX5300_CMD_SET_SNGL_CYCL      0x19
-#define YX5300_CMD_SET_DAC            0x1A
-#define YX5300_CMD_PLAY_WITH_VOL      0x22
-#define YX5300_CMD_QUERY_STATUS       0x42
-#define YX5300_CMD_QUERY_VOLUME       0x43
-#define YX5300_CMD_QUERY_TOT_TRACKS   0x48
-#define YX5300_CMD_PLAYING_N          0x4C
-#define YX5300_CMD_QUERY_FLDR_TRACKS  0x4E
-#define YX5300_CMD_QUERY_FLDR_COUNT   0x4F
+ * @brief  Number of copies that YX5300_GetStatusSnapshot tries without the lock
+ */
+#define YX5300_SNAPSHOT_RETRIES       8
+
+#if (YX5300_USE_CACHE)
+/**
+ * @brief  Cached values (bits of Cache.Valid)
+ */
+#define YX5300_CACHE_VOLUME           0x01
+#define YX5300_CACHE_TRACK            0x02
+#define YX5300_CACHE_STATE            0x04
+#define YX5300_CACHE_FOLDER           0x08
+#define YX5300_CACHE_ALL              0x0F
+#endif
+
+#if (YX5300_USE_CACHE && !YX5300_USE_TX_QUEUE)
+#error "YX5300_USE_CACHE requires YX5300_USE_TX_QUEUE"
+#endif
+
+#if (YX5300_USE_POSITION && !YX5300_USE_TX_QUEUE)
+#error "YX5300_USE_POSITION requires YX5300_USE_TX_QUEUE"
+#endif
+
+#if (YX5300_USE_TX_COALESCE)
+/**
+ * @brief  Predicted values of Tx queue (bits of Tx.Known)
+ */
+#define YX5300_TX_KNOWN_VOLUME        0x01
+#define YX5300_TX_KNOWN_TRACK         0x02
+#endif
+
+#if (YX5300_USE_TX_QUEUE && YX5300_USE_FADE)
+/**
+ * @brief  Volume of fade that is not known yet
+ */
+#define YX5300_FADE_UNKNOWN           0xFF
+#endif
+
+#if (YX5300_USE_BATCH)
+/**
+ * @brief  States of batch
+ */
+#define YX5300_BATCH_IDLE             0
+#define YX5300_BATCH_RECORDING        1
+#define YX5300_BATCH_PENDING          2
+
+/**
+ * @brief  Command code of the Tx queue entry of a batch (not a module command)
+ */
+#define YX5300_TX_BATCH               0x00
+
+#if (YX5300_BATCH_SIZE * YX5300_FRAME_SIZE > 255)
+#error "Frames of a batch must fit in 255 bytes"
+#endif
+#endif
+
+#if (YX5300_USE_POSITION)
+/**
+ * @brief  Cycle modes of playback position
+ */
+#define YX5300_POSITION_CYCLE_NONE    0
+#define YX5300_POSITION_CYCLE_TRACK   1
+#define YX5300_POSITION_CYCLE_FOLDER  2
+
+/**
+ * @brief  Minimum play time of a repeated track in ms
+ */
+#define YX5300_POSITION_MIN_TRACK     500
+#endif
+
+#if (YX5300_USE_PLAYLIST)
+/**
+ * @brief  Minimum play time of a playlist item in ms (the doubled "completed
+ *         play" response comes earlier)
+ */
+#define YX5300_PLAYLIST_MIN_TRACK     500
+#endif
+
+#if (YX5300_USE_LIBRARY)
+/**
+ * @brief  First byte of media library snapshots
+ */
+#define YX5300_LIBRARY_MAGIC          0x59
+
+/**
+ * @brief  Library.Pending value while YX5300_Init runs (its responses must not
+ *         start the scan)
+ */
+#define YX5300_LIBRARY_INIT           0xFF
+#endif
+
+
+/* Private Macro ----------------------------------------------------------------*/
+/**
+ * @brief  Full memory barrier used by status snapshot
+ */
+#ifndef YX5300_MEMORY_BARRIER
+#if defined(__GNUC__)
+#define YX5300_MEMORY_BARRIER()   __sync_synchronize()
+#else
+#define YX5300_MEMORY_BARRIER()
+#endif
+#endif
+
+/**
+ * @brief  Update link statistics
+ */
+#if (YX5300_USE_STATS)
+#define YX5300_STATS_ADD(HANDLER, FIELD, N)   ((HANDLER)->Stats.Counters.FIELD += (N))
+#else
+#define YX5300_STATS_ADD(HANDLER, FIELD, N)   ((void)0)
+#endif
+#define YX5300_STATS_INC(HANDLER, FIELD)      YX5300_STATS_ADD(HANDLER, FIELD, 1)
+
+/**
+ * @brief  Build a constant frame for commands without data
+ */
+#if (YX5300_USE_CHECKSUM)
+#define YX5300_CONST_FRAME(CMD, FBK)  YX5300_FRAME_LONG(CMD, FBK, 0x00, 0x00)
+#else
+#define YX5300_CONST_FRAME(CMD, FBK)  YX5300_FRAME_SHORT(CMD, FBK, 0x00, 0x00)
+#endif
+
+
+/* Private Variables ------------------------------------------------------------*/
+/**
+ * @brief  Precomputed frames of commands without data
+ */
+enum
+{
+  YX5300_CONST_FRAME_NEXT = 0,
+  YX5300_CONST_FRAME_PREV,
+  YX5300_CONST_FRAME_VOL_UP,
+  YX5300_CONST_FRAME_VOL_DOWN,
+  YX5300_CONST_FRAME_PLAY,
+  YX5300_CONST_FRAME_PAUSE,
+  YX5300_CONST_FRAME_STOP,
+  YX5300_CONST_FRAME_COUNT
+};
+
+static const uint8_t YX5300_ConstFrames[2][YX5300_CONST_FRAME_COUNT][YX5300_FRAME_SIZE] =
+{
+  [YX5300_CMD_NOT_FEEDBACK] =
+  {
+    [YX5300_CONST_FRAME_NEXT]     = YX5300_CONST_FRAME(YX5300_CMD_NEXT, YX5300_CMD_NOT_FEEDBACK),
+    [YX5300_CONST_FRAME_PREV]     = YX5300_CONST_FRAME(YX5300_CMD_PREV, YX5300_CMD_NOT_FEEDBACK),
+    [YX5300_CONST_FRAME_VOL_UP]   = YX5300_CONST_FRAME(YX5300_CMD_VOL_UP, YX5300_CMD_NOT_FEEDBACK),
+    [YX5300_CONST_FRAME_VOL_DOWN] = YX5300_CONST_FRAME(YX5300_CMD_VOL_DOWN, YX5300_CMD_NOT_FEEDBACK),
+    [YX5300_CONST_FRAME_PLAY]     = YX5300_CONST_FRAME(YX5300_CMD_PLAY, YX5300_CMD_NOT_FEEDBACK),
+    [YX5300_CONST_FRAME_PAUSE]    = YX5300_CONST_FRAME(YX5300_CMD_PAUSE, YX5300_CMD_NOT_FEEDBACK),
+    [YX5300_CONST_FRAME_STOP]     = YX5300_CONST_FRAME(YX5300_CMD_STOP, YX5300_CMD_NOT_FEEDBACK),
+  },
+  [YX5300_CMD_FEEDBACK] =
+  {
+    [YX5300_CONST_FRAME_NEXT]     = YX5300_CONST_FRAME(YX5300_CMD_NEXT, YX5300_CMD_FEEDBACK),
+    [YX5300_CONST_FRAME_PREV]     = YX5300_CONST_FRAME(YX5300_CMD_PREV, YX5300_CMD_FEEDBACK),
+    [YX5300_CONST_FRAME_VOL_UP]   = YX5300_CONST_FRAME(YX5300_CMD_VOL_UP, YX5300_CMD_FEEDBACK),
+    [YX5300_CONST_FRAME_VOL_DOWN] = YX5300_CONST_FRAME(YX5300_CMD_VOL_DOWN, YX5300_CMD_FEEDBACK),
+    [YX5300_CONST_FRAME_PLAY]     = YX5300_CONST_FRAME(YX5300_CMD_PLAY, YX5300_CMD_FEEDBACK),
+    [YX5300_CONST_FRAME_PAUSE]    = YX5300_CONST_FRAME(YX5300_CMD_PAUSE, YX5300_CMD_FEEDBACK),
+    [YX5300_CONST_FRAME_STOP]     = YX5300_CONST_FRAME(YX5300_CMD_STOP, YX5300_CMD_FEEDBACK),
+  },
+};
 
 
 
@@ -80,380 +207,4100 @@
  ==================================================================================
  */
 
-static YX5300_Result_t
-YX5300_SendCommand(YX5300_Handler_t *Handler,
-                   uint8_t Command, uint8_t Data1, uint8_t Data2)
+static inline void
+YX5300_Lock(YX5300_Handler_t *Handler)
+{
+  if (Handler->Platform.Lock)
+    Handler->Platform.Lock(Handler->Platform.UserCtx);
+}
+
+
+static inline void
+YX5300_Unlock(YX5300_Handler_t *Handler)
+{
+  if (Handler->Platform.Unlock)
+    Handler->Platform.Unlock(Handler->Platform.UserCtx);
+}
+
+
+static inline void
+YX5300_StatusWriteBegin(YX5300_Handler_t *Handler)
 {
-  uint8_t Data[8] = {0};
+  // Odd sequence number means the status is being updated
+  Handler->StatusSeq++;
+  YX5300_MEMORY_BARRIER();
+}
+
+
+static inline void
+YX5300_StatusWriteEnd(YX5300_Handler_t *Handler)
+{
+  YX5300_MEMORY_BARRIER();
+  Handler->StatusSeq++;
+}
+
+
+#if (YX5300_USE_TX_QUEUE)
+static inline uint8_t
+YX5300_TxPending(YX5300_Handler_t *Handler)
+{
+#if (YX5300_USE_TX_PRIORITY)
+  return Handler->Tx.Count + Handler->Tx.UrgentCount;
+#else
+  return Handler->Tx.Count;
+#endif
+}
+#endif
+
+
+static inline const uint8_t *
+YX5300_GetConstFrame(uint8_t Command, uint8_t Feedback)
+{
+  const uint8_t (*Frames)[YX5300_FRAME_SIZE] = YX5300_ConstFrames[Feedback];
+
+  switch (Command)
+  {
+  case YX5300_CMD_NEXT:     return Frames[YX5300_CONST_FRAME_NEXT];
+  case YX5300_CMD_PREV:     return Frames[YX5300_CONST_FRAME_PREV];
+  case YX5300_CMD_VOL_UP:   return Frames[YX5300_CONST_FRAME_VOL_UP];
+  case YX5300_CMD_VOL_DOWN: return Frames[YX5300_CONST_FRAME_VOL_DOWN];
+  case YX5300_CMD_PLAY:     return Frames[YX5300_CONST_FRAME_PLAY];
+  case YX5300_CMD_PAUSE:    return Frames[YX5300_CONST_FRAME_PAUSE];
+  case YX5300_CMD_STOP:     return Frames[YX5300_CONST_FRAME_STOP];
+  default:                  return NULL;
+  }
+}
+
+
+#if (YX5300_USE_TX_QUEUE && YX5300_USE_FADE)
+static void
+YX5300_FadeOnSend(YX5300_Handler_t *Handler, const uint8_t *Frame)
+{
+  uint8_t Volume = Handler->Fade.Current;
+
+  // Volume of the module after the sent command
+  switch (Frame[3])
+  {
+  case YX5300_CMD_VOL_SET:
+    Handler->Fade.Current = Frame[6];
+    break;
+
+  case YX5300_CMD_PLAY_WITH_VOL:
+    Handler->Fade.Current = Frame[5];
+    break;
+
+  case YX5300_CMD_VOL_UP:
+    if (Volume < 30)
+      Handler->Fade.Current = Volume + 1;
+    break;
+
+  case YX5300_CMD_VOL_DOWN:
+    if (Volume != YX5300_FADE_UNKNOWN && Volume > 0)
+      Handler->Fade.Current = Volume - 1;
+    break;
+
+  case YX5300_CMD_RESET:
+    Handler->Fade.Current = YX5300_FADE_UNKNOWN;
+    break;
+
+  default:
+    break;
+  }
+}
+#endif
 
-  Data[0] = YX5300_CMD_START_BYTE;  // Start byte
-  Data[1] = YX5300_CMD_VERSION;     // Version
-  Data[2] = 0x06;                   // Length
-  Data[3] = Command;                // Command
-  Data[4] = YX5300_CMD_FEEDBACK;    // Feedback
-  Data[5] = Data1;                  // Data1 or High byte of the data
-  Data[6] = Data2;                  // Data2 or Low byte of the data
-  Data[7] = YX5300_CMD_END_BYTE;    // End byte
 
-  if (Handler->Platform.Send(Data, 8) < 0)
+static YX5300_Result_t
+YX5300_TransmitFrames(YX5300_Handler_t *Handler, const uint8_t *Frames,
+                      uint8_t Count, uint8_t *Sent)
+{
+  const uint8_t *Last = NULL;
+  int8_t Result = 0;
+#if (YX5300_USE_TX_QUEUE && YX5300_USE_FADE)
+  uint8_t i = 0;
+#endif
+#if (YX5300_USE_STATS)
+  uint32_t Tick = 0;
+#endif
+
+  // Send function does not modify the data
+  Result = Handler->Platform.Send(Handler->Platform.UserCtx, (uint8_t *)Frames,
+                                  (uint8_t)(Count * YX5300_FRAME_SIZE));
+  if (Result < 0)
     return YX5300_FAIL;
 
-  Handler->Status.LastCommand = Command;
-  Handler->Status.LastCommandData = (Data1 << 8) | Data2;
+  // Platform layer may send only the first frames of a batch
+  if (Result > 0 && Result < Count)
+    Count = (uint8_t)Result;
+  if (Sent)
+    *Sent = Count;
+
+  // Status shows the last command
+  Last = &Frames[(Count - 1) * YX5300_FRAME_SIZE];
+
+#if (YX5300_USE_STATS)
+  if (Handler->Platform.GetTick)
+    Tick = Handler->Platform.GetTick(Handler->Platform.UserCtx);
+#endif
+
+  YX5300_Lock(Handler);
+#if (YX5300_USE_TX_QUEUE && YX5300_USE_FADE)
+  for (i = 0; i < Count; i++)
+    YX5300_FadeOnSend(Handler, &Frames[i * YX5300_FRAME_SIZE]);
+#endif
+#if (YX5300_USE_STATS)
+  YX5300_STATS_ADD(Handler, FramesSent, Count);
+  YX5300_STATS_ADD(Handler, BytesSent, Count * YX5300_FRAME_SIZE);
+  Handler->Stats.WaitAck = (Last[4] == YX5300_CMD_FEEDBACK &&
+                            Handler->Platform.GetTick != NULL);
+  Handler->Stats.SendTick = Tick;
+#endif
+  YX5300_StatusWriteBegin(Handler);
+  Handler->Status.LastCommand = Last[3];
+  Handler->Status.LastCommandData = (Last[5] << 8) | Last[6];
   Handler->Status.LastResponse = 0;
   Handler->Status.LastResponseData = 0;
+  YX5300_StatusWriteEnd(Handler);
+  YX5300_Unlock(Handler);
 
   return YX5300_OK;
 }
 
 
 static YX5300_Result_t
-YX5300_ParseResponse(YX5300_Handler_t *Handler)
+YX5300_TransmitCommand(YX5300_Handler_t *Handler, uint8_t Command,
+                       uint8_t Feedback, uint8_t Data1, uint8_t Data2)
 {
-  // Response Structure  0x7E 0xFF 0x06 RSP 0x00 0x00 DAT 0xFE 0xBA 0xEF
-  // RSP: Response code
-  // DAT: Data
+  uint8_t Data[YX5300_FRAME_SIZE];
+  const uint8_t *Frame = NULL;
 
-  Handler->Status.LastResponse = Handler->Rx.Buffer[3];
-  Handler->Status.LastResponseData = (Handler->Rx.Buffer[5] << 8) | Handler->Rx.Buffer[6];
+  if (Data1 == 0 && Data2 == 0)
+    Frame = YX5300_GetConstFrame(Command, Feedback);
+
+  if (Frame == NULL)
+  {
+    YX5300_CodecEncode(Data, Command, Feedback, Data1, Data2, YX5300_USE_CHECKSUM);
+    Frame = Data;
+  }
+
+  return YX5300_TransmitFrames(Handler, Frame, 1, NULL);
+}
+
+
+#if (YX5300_USE_CACHE)
+static uint8_t
+YX5300_CacheMask(uint8_t Command)
+{
+  // Cached values that may be changed by the command
+  switch (Command)
+  {
+  case YX5300_CMD_VOL_UP:
+  case YX5300_CMD_VOL_DOWN:
+  case YX5300_CMD_VOL_SET:
+    return YX5300_CACHE_VOLUME;
+
+  case YX5300_CMD_NEXT:
+  case YX5300_CMD_PREV:
+  case YX5300_CMD_PLAY_INDEX:
+  case YX5300_CMD_PLAY_FOLD_FILE:
+  case YX5300_CMD_SINGLE_CYCLE:
+  case YX5300_CMD_PLAY_CYCLE_FOLD:
+    return YX5300_CACHE_TRACK | YX5300_CACHE_STATE | YX5300_CACHE_FOLDER;
+
+  case YX5300_CMD_PLAY:
+  case YX5300_CMD_PAUSE:
+    return YX5300_CACHE_STATE;
+
+  case YX5300_CMD_STOP:
+    return YX5300_CACHE_TRACK | YX5300_CACHE_STATE;
+
+  case YX5300_CMD_SET_SNGL_CYCL:
+  case YX5300_CMD_SET_DAC:
+  case YX5300_CMD_QUERY_STATUS:
+  case YX5300_CMD_QUERY_VOLUME:
+  case YX5300_CMD_QUERY_TOT_TRACKS:
+  case YX5300_CMD_PLAYING_N:
+  case YX5300_CMD_QUERY_FLDR_TRACKS:
+  case YX5300_CMD_QUERY_FLDR_COUNT:
+    return 0;
+
+  default:
+    return YX5300_CACHE_ALL;
+  }
+}
+
+
+static uint8_t
+YX5300_CacheQueued(YX5300_Handler_t *Handler)
+{
+  uint8_t Mask = 0;
+#if (YX5300_USE_TX_QUEUE)
+  uint8_t Index = Handler->Tx.Tail;
+  uint8_t i = 0;
+
+  for (i = 0; i < Handler->Tx.Count; i++)
+  {
+    Mask |= YX5300_CacheMask(Handler->Tx.Queue[Index].Command);
+    Index = (Index + 1) % YX5300_TX_QUEUE_SIZE;
+  }
+#if (YX5300_USE_TX_PRIORITY)
+  Index = Handler->Tx.UrgentTail;
+  for (i = 0; i < Handler->Tx.UrgentCount; i++)
+  {
+    Mask |= YX5300_CacheMask(Handler->Tx.Urgent[Index].Command);
+    Index = (Index + 1) % YX5300_TX_URGENT_SIZE;
+  }
+#endif
+#else
+  (void)Handler;
+#endif
+
+  return Mask;
+}
+
+
+static void
+YX5300_CacheValidate(YX5300_Handler_t *Handler, uint8_t Mask)
+{
+  uint32_t Tick = 0;
+  uint8_t i = 0;
+
+  // A value changed by a command that is still in the queue is not confirmed
+  Mask &= ~YX5300_CacheQueued(Handler);
+
+  if (Handler->Platform.GetTick)
+    Tick = Handler->Platform.GetTick(Handler->Platform.UserCtx);
+
+  for (i = 0; i < 4; i++)
+  {
+    if (Mask & (1 << i))
+      Handler->Cache.Tick[i] = Tick;
+  }
+
+  Handler->Cache.Valid |= Mask;
+}
+
+
+static uint8_t
+YX5300_CacheIsFresh(YX5300_Handler_t *Handler, uint8_t Command)
+{
+  uint8_t Mask = 0;
+  uint8_t Bit = 0;
+  uint8_t Fresh = 0;
+
+  switch (Command)
+  {
+  case YX5300_CMD_QUERY_VOLUME: Mask = YX5300_CACHE_VOLUME; Bit = 0; break;
+  case YX5300_CMD_PLAYING_N:    Mask = YX5300_CACHE_TRACK;  Bit = 1; break;
+  case YX5300_CMD_QUERY_STATUS: Mask = YX5300_CACHE_STATE;  Bit = 2; break;
+  default:                      return 0;
+  }
+
+  if (Handler->Platform.GetTick == NULL)
+    return 0;
+
+  YX5300_Lock(Handler);
+  Fresh = (Handler->Cache.Valid & Mask) &&
+          (uint32_t)(Handler->Platform.GetTick(Handler->Platform.UserCtx) -
+                     Handler->Cache.Tick[Bit]) < YX5300_CACHE_MAX_AGE;
+  YX5300_Unlock(Handler);
+
+  return Fresh;
+}
+
+
+static uint8_t
+YX5300_CacheIsRedundant(YX5300_Handler_t *Handler,
+                        uint8_t Command, uint8_t Data1, uint8_t Data2)
+{
+  uint8_t Valid = Handler->Cache.Valid;
+  uint8_t State = Handler->Status.StatusByte;
+  uint8_t Playing = (Valid & YX5300_CACHE_STATE) && State == 0x01;
+
+  switch (Command)
+  {
+  case YX5300_CMD_VOL_SET:
+    return (Valid & YX5300_CACHE_VOLUME) && Handler->Status.Volume == Data2;
+
+  case YX5300_CMD_PLAY_INDEX:
+    return Playing && (Valid & YX5300_CACHE_TRACK) &&
+           Handler->Status.Track == ((Data1 << 8) | Data2);
+
+  case YX5300_CMD_PLAY_FOLD_FILE:
+    return Playing && (Valid & YX5300_CACHE_FOLDER) &&
+           Handler->Cache.Folder == Data1 && Handler->Cache.File == Data2;
+
+  case YX5300_CMD_PLAY_CYCLE_FOLD:
+    return Playing && (Valid & YX5300_CACHE_FOLDER) &&
+           Handler->Cache.Folder == Data1 && Handler->Cache.File == 0;
+
+  case YX5300_CMD_PLAY_WITH_VOL:
+    return Playing && (Valid & YX5300_CACHE_TRACK) &&
+           (Valid & YX5300_CACHE_VOLUME) &&
+           Handler->Status.Track == Data2 && Handler->Status.Volume == Data1;
+
+  case YX5300_CMD_PLAY:
+    return Playing;
+
+  case YX5300_CMD_PAUSE:
+    return (Valid & YX5300_CACHE_STATE) && State == 0x02;
+
+  case YX5300_CMD_STOP:
+    return (Valid & YX5300_CACHE_STATE) && State == 0x00;
+
+  default:
+    return 0;
+  }
+}
+
+
+static uint8_t
+YX5300_CacheOnAck(YX5300_Handler_t *Handler)
+{
+  uint8_t Data1 = (uint8_t)(Handler->Status.LastCommandData >> 8);
+  uint8_t Data2 = (uint8_t)(Handler->Status.LastCommandData & 0xFF);
+
+  // Apply the effect of the acknowledged command to the status
+  switch (Handler->Status.LastCommand)
+  {
+  case YX5300_CMD_VOL_SET:
+    Handler->Status.Volume = Data2;
+    return YX5300_CACHE_VOLUME;
+
+  case YX5300_CMD_PLAY_INDEX:
+    Handler->Status.Track = Handler->Status.LastCommandData;
+    Handler->Status.StatusByte = 0x01;
+    return YX5300_CACHE_TRACK | YX5300_CACHE_STATE;
+
+  case YX5300_CMD_SINGLE_CYCLE:
+    Handler->Status.Track = Handler->Status.LastCommandData;
+    Handler->Status.StatusByte = 0x01;
+    return YX5300_CACHE_TRACK | YX5300_CACHE_STATE;
+
+  case YX5300_CMD_PLAY_WITH_VOL:
+    Handler->Status.Volume = Data1;
+    Handler->Status.Track = Data2;
+    Handler->Status.StatusByte = 0x01;
+    return YX5300_CACHE_VOLUME | YX5300_CACHE_TRACK | YX5300_CACHE_STATE;
+
+  case YX5300_CMD_PLAY_FOLD_FILE:
+  case YX5300_CMD_PLAY_CYCLE_FOLD:
+    // File 0 means the whole folder is repeated
+    Handler->Cache.Folder = Data1;
+    Handler->Cache.File = Data2;
+    Handler->Status.StatusByte = 0x01;
+    return YX5300_CACHE_FOLDER | YX5300_CACHE_STATE;
+
+  case YX5300_CMD_NEXT:
+  case YX5300_CMD_PREV:
+  case YX5300_CMD_PLAY:
+    Handler->Status.StatusByte = 0x01;
+    return YX5300_CACHE_STATE;
+
+  case YX5300_CMD_PAUSE:
+    Handler->Status.StatusByte = 0x02;
+    return YX5300_CACHE_STATE;
+
+  case YX5300_CMD_STOP:
+    Handler->Status.StatusByte = 0x00;
+    Handler->Status.Track = 0;
+    return YX5300_CACHE_STATE | YX5300_CACHE_TRACK;
+
+  default:
+    return 0;
+  }
+}
+
+
+static void
+YX5300_CacheOnResponse(YX5300_Handler_t *Handler, uint8_t Acked)
+{
+  uint8_t Mask = 0;
 
   switch (Handler->Status.LastResponse)
   {
   case 0x3A: // Memory card inserted
-    Handler->Status.MemoryInserted = 1;
-    break;
+  case 0x3B: // Memory card removed
+  case 0x3F: // Initialization done
+    Handler->Cache.Valid = 0;
+    return;
 
-  case 0x3D: // Completed play num 'DAT'
-    Handler->Status.Track = 0;
-    break;
+  case 0x3D: // Completed play
+    Handler->Cache.Valid &= ~(YX5300_CACHE_TRACK | YX5300_CACHE_STATE |
+                              YX5300_CACHE_FOLDER);
+    return;
 
   case 0x40: // Error
-    break;
+    Handler->Cache.Valid &= ~YX5300_CacheMask(Handler->Status.LastCommand);
+    return;
 
   case 0x41: // Data received correctly
+    // Only the ACK of the command that is waiting for it confirms the command
+    if (!Acked)
+      return;
+    Mask = YX5300_CacheOnAck(Handler);
     break;
 
-  case 0x42: // Status 'DAT'
-    Handler->Status.StatusByte = Handler->Status.LastResponseData;
+  case 0x42: // Status
+    Mask = YX5300_CACHE_STATE;
     if (Handler->Status.StatusByte == 0x00)
-      Handler->Status.Track = 0;
+      Mask |= YX5300_CACHE_TRACK;
     break;
 
-  case 0x43: // Vol playing 'DAT'
-    Handler->Status.Volume = Handler->Status.LastResponseData;
+  case 0x43: // Volume
+    Mask = YX5300_CACHE_VOLUME;
     break;
 
-  case 0x48: // File count 'DAT'
-    Handler->Status.Track = Handler->Status.LastResponseData;
+  case 0x4C: // Playing track
+    Mask = YX5300_CACHE_TRACK;
+    break;
+
+  default:
+    return;
+  }
+
+  YX5300_CacheValidate(Handler, Mask);
+}
+#endif
+
+
+#if (YX5300_USE_TX_QUEUE && YX5300_USE_TX_COALESCE)
+static void
+YX5300_TxPredict(YX5300_Handler_t *Handler,
+                 uint8_t *Command, uint8_t *Data1, uint8_t *Data2)
+{
+  uint8_t Volume = Handler->Tx.Volume;
+  uint16_t Track = Handler->Tx.Track;
+  uint16_t Total = Handler->Status.TotalTracks;
+  uint8_t Known = Handler->Tx.Known;
+
+  // Convert steps to absolute commands if the result is predictable
+  switch (*Command)
+  {
+  case YX5300_CMD_VOL_UP:
+  case YX5300_CMD_VOL_DOWN:
+    if (!(Known & YX5300_TX_KNOWN_VOLUME))
+      break;
+    if (*Command == YX5300_CMD_VOL_UP)
+      Volume = (Volume < 30) ? Volume + 1 : 30;
+    else
+      Volume = (Volume > 0) ? Volume - 1 : 0;
+    *Command = YX5300_CMD_VOL_SET;
+    *Data1 = 0;
+    *Data2 = Volume;
     break;
 
-  case 0x4C: // Folder 'DAT'
+  case YX5300_CMD_NEXT:
+  case YX5300_CMD_PREV:
+    if (!(Known & YX5300_TX_KNOWN_TRACK) || Total == 0 || Track == 0)
+      break;
+    if (*Command == YX5300_CMD_NEXT)
+      Track = (Track >= Total) ? 1 : Track + 1;
+    else
+      Track = (Track <= 1) ? Total : Track - 1;
+    *Command = YX5300_CMD_PLAY_INDEX;
+    *Data1 = (uint8_t)(Track >> 8);
+    *Data2 = (uint8_t)(Track & 0xFF);
     break;
 
-  case 0x4E: // Folder file count 'DAT'
+  default:
     break;
+  }
 
-  case 0x4F: // Folder file 'DAT'
+  // Values after sending all queued commands
+  switch (*Command)
+  {
+  case YX5300_CMD_VOL_SET:
+    Handler->Tx.Volume = *Data2;
+    Handler->Tx.Known |= YX5300_TX_KNOWN_VOLUME;
     break;
 
-  default: // Unrecognized response
-    return YX5300_FAIL;
+  case YX5300_CMD_VOL_UP:
+  case YX5300_CMD_VOL_DOWN:
+    Handler->Tx.Known &= ~YX5300_TX_KNOWN_VOLUME;
+    break;
+
+  case YX5300_CMD_PLAY_INDEX:
+  case YX5300_CMD_SINGLE_CYCLE:
+    Handler->Tx.Track = (*Data1 << 8) | *Data2;
+    Handler->Tx.Known |= YX5300_TX_KNOWN_TRACK;
+    break;
+
+  case YX5300_CMD_PLAY_WITH_VOL:
+    Handler->Tx.Volume = *Data1;
+    Handler->Tx.Track = *Data2;
+    Handler->Tx.Known |= YX5300_TX_KNOWN_VOLUME | YX5300_TX_KNOWN_TRACK;
+    break;
+
+  case YX5300_CMD_NEXT:
+  case YX5300_CMD_PREV:
+  case YX5300_CMD_PLAY_FOLD_FILE:
+  case YX5300_CMD_PLAY_CYCLE_FOLD:
+  case YX5300_CMD_STOP:
+    Handler->Tx.Known &= ~YX5300_TX_KNOWN_TRACK;
+    break;
+
+  case YX5300_CMD_RESET:
+    Handler->Tx.Known = 0;
+    break;
+
+  default:
     break;
   }
+}
 
-  return YX5300_OK;
+
+static uint8_t
+YX5300_TxCoalesce(YX5300_Handler_t *Handler, uint8_t Command,
+                  uint8_t Feedback, uint8_t Data1, uint8_t Data2)
+{
+  uint8_t Last = 0;
+
+  if (Command != YX5300_CMD_VOL_SET && Command != YX5300_CMD_PLAY_INDEX)
+    return 0;
+
+  if (Handler->Tx.Count == 0)
+    return 0;
+
+  // The last queued command can be replaced only if it is not being sent
+  Last = (Handler->Tx.Head + YX5300_TX_QUEUE_SIZE - 1) % YX5300_TX_QUEUE_SIZE;
+  if (Handler->Tx.Sending == 1 && Last == Handler->Tx.Tail)
+    return 0;
+
+  if (Handler->Tx.Queue[Last].Command != Command)
+    return 0;
+
+  Handler->Tx.Queue[Last].Feedback = Feedback;
+  Handler->Tx.Queue[Last].Data1 = Data1;
+  Handler->Tx.Queue[Last].Data2 = Data2;
+  return 1;
+}
+
+
+static void
+YX5300_TxOnResponse(YX5300_Handler_t *Handler)
+{
+  switch (Handler->Status.LastResponse)
+  {
+  case 0x3A: // Memory card inserted
+  case 0x3B: // Memory card removed
+  case 0x3F: // Initialization done
+  case 0x40: // Error
+    Handler->Tx.Known = 0;
+    break;
+
+  case 0x3D: // Completed play
+    if (YX5300_TxPending(Handler) == 0)
+      Handler->Tx.Known &= ~YX5300_TX_KNOWN_TRACK;
+    break;
+
+  case 0x43: // Volume
+    // The reply is the final volume only if no command is waiting
+    if (YX5300_TxPending(Handler) != 0)
+      break;
+    Handler->Tx.Volume = Handler->Status.Volume;
+    Handler->Tx.Known |= YX5300_TX_KNOWN_VOLUME;
+    break;
+
+  case 0x4C: // Playing track
+    if (YX5300_TxPending(Handler) != 0)
+      break;
+    Handler->Tx.Track = Handler->Status.Track;
+    Handler->Tx.Known |= YX5300_TX_KNOWN_TRACK;
+    break;
+
+  default:
+    break;
+  }
 }
+#endif
+
+
+#if (YX5300_USE_TX_QUEUE && YX5300_USE_TX_RETRY)
+static uint16_t
+YX5300_TxRto(YX5300_Handler_t *Handler)
+{
+  uint16_t Max = Handler->Tx.AckTimeout ?
+                 Handler->Tx.AckTimeout : YX5300_TX_ACK_TIMEOUT;
+  uint32_t Rto = 0;
+
+  if (Handler->Tx.Srtt == 0)
+    return Max;
+
+  // RTO = SRTT + 4 * RTTVAR (RTTVAR is already scaled by 4)
+  Rto = Handler->Tx.Rttvar;
+  if (Rto < YX5300_TX_RTO_MARGIN)
+    Rto = YX5300_TX_RTO_MARGIN;
+  Rto += Handler->Tx.Srtt >> 3;
+
+  return (Rto < Max) ? (uint16_t)Rto : Max;
+}
+
+
+static void
+YX5300_TxOnAck(YX5300_Handler_t *Handler)
+{
+  uint32_t Rtt = 0;
+  int32_t Delta = 0;
+
+  if (Handler->Tx.WaitAck != 1)
+    return;
+
+  // The ACK of a command that is sent again may belong to any of its copies
+  // (Karn's algorithm), so it is not measured
+  if (Handler->Tx.Retries != 0)
+    return;
+
+  Rtt = Handler->Platform.GetTick(Handler->Platform.UserCtx) - Handler->Tx.SendTick;
+  if (Rtt == 0)
+    Rtt = 1;
+  if (Rtt > 0x0FFF)
+    Rtt = 0x0FFF;
+
+  if (Handler->Tx.Srtt == 0)
+  {
+    Handler->Tx.Srtt = (uint16_t)(Rtt << 3);
+    Handler->Tx.Rttvar = (uint16_t)(Rtt << 1);
+    return;
+  }
+
+  // SRTT += (RTT - SRTT) / 8, RTTVAR += (|RTT - SRTT| - RTTVAR) / 4
+  Delta = (int32_t)Rtt - (Handler->Tx.Srtt >> 3);
+  Handler->Tx.Srtt = (uint16_t)(Handler->Tx.Srtt + Delta);
+  if (Delta < 0)
+    Delta = -Delta;
+  Handler->Tx.Rttvar = (uint16_t)(Handler->Tx.Rttvar + Delta - (Handler->Tx.Rttvar >> 2));
+}
+
+
+static void
+YX5300_TxOnError(YX5300_Handler_t *Handler)
+{
+  // Only busy, serial receiving and checksum errors may pass on the next try
+  switch (Handler->Status.LastResponseData & 0xFF)
+  {
+  case 0x01:
+  case 0x03:
+  case 0x04:
+    break;
+
+  default:
+    return;
+  }
+
+  if (Handler->Tx.WaitAck == 1 && Handler->Tx.Retries < YX5300_TX_RETRY_COUNT)
+    Handler->Tx.Retry = 1;
+}
+#endif
+
+
+#if (YX5300_USE_TX_QUEUE)
+static YX5300_Result_t
+YX5300_TxPush(YX5300_Handler_t *Handler, uint8_t Command,
+              uint8_t Feedback, uint8_t Data1, uint8_t Data2)
+{
+#if (YX5300_USE_TX_COALESCE)
+  YX5300_TxPredict(Handler, &Command, &Data1, &Data2);
+  if (YX5300_TxCoalesce(Handler, Command, Feedback, Data1, Data2))
+    return YX5300_OK;
+#endif
+
+  if (Handler->Tx.Count >= YX5300_TX_QUEUE_SIZE)
+  {
+#if (YX5300_USE_TX_COALESCE)
+    // The prediction included the rejected command
+    Handler->Tx.Known = 0;
+#endif
+    return YX5300_QUEUE_FULL;
+  }
+
+  Handler->Tx.Queue[Handler->Tx.Head].Command = Command;
+  Handler->Tx.Queue[Handler->Tx.Head].Feedback = Feedback;
+  Handler->Tx.Queue[Handler->Tx.Head].Data1 = Data1;
+  Handler->Tx.Queue[Handler->Tx.Head].Data2 = Data2;
+  Handler->Tx.Head = (Handler->Tx.Head + 1) % YX5300_TX_QUEUE_SIZE;
+  Handler->Tx.Count++;
+
+  return YX5300_OK;
+}
+#endif
+
+
+#if (YX5300_USE_TX_QUEUE && YX5300_USE_TX_PRIORITY)
+#if (YX5300_TX_PREEMPT)
+static void
+YX5300_TxPreempt(YX5300_Handler_t *Handler)
+{
+  uint8_t Read = Handler->Tx.Tail;
+  uint8_t Write = Handler->Tx.Tail;
+  uint8_t Count = 0;
+  uint8_t Keep = 0;
+  uint8_t i = 0;
+
+  // Drop the commands of normal lane that a stop makes pointless
+  for (i = 0; i < Handler->Tx.Count; i++)
+  {
+    switch (Handler->Tx.Queue[Read].Command)
+    {
+    case YX5300_CMD_NEXT:
+    case YX5300_CMD_PREV:
+    case YX5300_CMD_PLAY_INDEX:
+    case YX5300_CMD_SINGLE_CYCLE:
+    case YX5300_CMD_PLAY:
+    case YX5300_CMD_PAUSE:
+    case YX5300_CMD_PLAY_FOLD_FILE:
+    case YX5300_CMD_STOP:
+    case YX5300_CMD_PLAY_CYCLE_FOLD:
+      Keep = 0;
+      break;
+
+    default:
+      Keep = 1;
+      break;
+    }
+
+    // The command that is being sent stays in the queue
+    if (i == 0 && Handler->Tx.Sending == 1)
+      Keep = 1;
+
+    if (Keep)
+    {
+      Handler->Tx.Queue[Write] = Handler->Tx.Queue[Read];
+      Write = (Write + 1) % YX5300_TX_QUEUE_SIZE;
+      Count++;
+    }
+    Read = (Read + 1) % YX5300_TX_QUEUE_SIZE;
+  }
+
+  Handler->Tx.Head = Write;
+  Handler->Tx.Count = Count;
+}
+#endif
+
+
+static YX5300_Result_t
+YX5300_TxPushUrgent(YX5300_Handler_t *Handler, uint8_t Command,
+                    uint8_t Feedback, uint8_t Data1, uint8_t Data2)
+{
+  if (Handler->Tx.UrgentCount >= YX5300_TX_URGENT_SIZE)
+    return YX5300_QUEUE_FULL;
+
+#if (YX5300_USE_TX_COALESCE)
+  // The command is sent before the normal lane, so the prediction holds only
+  // if the normal lane is empty
+  if (Handler->Tx.Count == 0)
+    YX5300_TxPredict(Handler, &Command, &Data1, &Data2);
+  else
+    Handler->Tx.Known = 0;
+#endif
+
+#if (YX5300_TX_PREEMPT)
+  if (Command == YX5300_CMD_STOP)
+    YX5300_TxPreempt(Handler);
+#endif
+
+  Handler->Tx.Urgent[Handler->Tx.UrgentHead].Command = Command;
+  Handler->Tx.Urgent[Handler->Tx.UrgentHead].Feedback = Feedback;
+  Handler->Tx.Urgent[Handler->Tx.UrgentHead].Data1 = Data1;
+  Handler->Tx.Urgent[Handler->Tx.UrgentHead].Data2 = Data2;
+  Handler->Tx.UrgentHead = (Handler->Tx.UrgentHead + 1) % YX5300_TX_URGENT_SIZE;
+  Handler->Tx.UrgentCount++;
+
+  return YX5300_OK;
+}
+#endif
+
+
+#if (YX5300_USE_TX_QUEUE && YX5300_USE_FADE)
+static void
+YX5300_FadeStart(YX5300_Handler_t *Handler, uint32_t Tick,
+                 uint8_t Start, uint8_t Target, uint16_t Duration)
+{
+  Handler->Fade.Start = Start;
+  Handler->Fade.Target = Target;
+  Handler->Fade.Volume = Start;
+  Handler->Fade.Duration = Duration;
+  Handler->Fade.StartTick = Tick;
+  Handler->Fade.Active = 1;
+}
+
+
+static void
+YX5300_FadeStep(YX5300_Handler_t *Handler, uint32_t Tick)
+{
+  uint8_t Feedback = YX5300_CMD_FEEDBACK;
+  uint32_t Elapsed = 0;
+  uint8_t Volume = 0;
+  uint8_t Done = 0;
+
+  if (!Handler->Fade.Active)
+    return;
+
+  // The step is computed when the previous command is finished, so the steps
+  // never outrun the module
+  if (YX5300_TxPending(Handler) != 0 ||
+      (Handler->Tx.WaitAck &&
+       (uint32_t)(Tick - Handler->Tx.SendTick) < Handler->Tx.Timeout))
+    return;
+#if (YX5300_USE_TX_RETRY)
+  if (Handler->Tx.Retry)
+    return;
+#endif
+
+  // Start of the fade is known after the previous commands are sent
+  if (Handler->Fade.Start == YX5300_FADE_UNKNOWN)
+  {
+    Handler->Fade.Start = Handler->Fade.Current;
+    Handler->Fade.Volume = Handler->Fade.Current;
+    Handler->Fade.StartTick = Tick;
+
+    // Volume of the module is unknown, so the target is set in one step
+    if (Handler->Fade.Start == YX5300_FADE_UNKNOWN)
+    {
+      Handler->Fade.Start = Handler->Fade.Target;
+      Handler->Fade.Duration = 0;
+    }
+  }
+
+  Elapsed = Tick - Handler->Fade.StartTick;
+  if (Elapsed >= Handler->Fade.Duration)
+  {
+    Volume = Handler->Fade.Target;
+    Done = 1;
+  }
+  else
+  {
+    Volume = (uint8_t)(Handler->Fade.Start +
+                       ((int32_t)Handler->Fade.Target - Handler->Fade.Start) *
+                       (int32_t)Elapsed / Handler->Fade.Duration);
+  }
+
+  if (Volume != Handler->Fade.Volume)
+  {
+    if (Handler->Feedback.Default == YX5300_FEEDBACK_DISABLE)
+      Feedback = YX5300_CMD_NOT_FEEDBACK;
+#if (YX5300_USE_CACHE)
+    Handler->Cache.Valid &= ~YX5300_CACHE_VOLUME;
+#endif
+    if (YX5300_TxPush(Handler, YX5300_CMD_VOL_SET, Feedback, 0, Volume) != YX5300_OK)
+      return;
+    Handler->Fade.Volume = Volume;
+  }
+
+  if (Done)
+    Handler->Fade.Active = 0;
+}
+#endif
+
+
+#if (YX5300_USE_BATCH)
+static YX5300_Result_t
+YX5300_BatchAdd(YX5300_Handler_t *Handler, uint8_t Command,
+                uint8_t Feedback, uint8_t Data1, uint8_t Data2)
+{
+  if (Handler->Batch.Count >= YX5300_BATCH_SIZE)
+    return YX5300_QUEUE_FULL;
+
+  // Feedback of the last command is set by YX5300_EndBatch
+  YX5300_CodecEncode(&Handler->Batch.Buffer[Handler->Batch.Count * YX5300_FRAME_SIZE],
+                     Command, YX5300_CMD_NOT_FEEDBACK, Data1, Data2,
+                     YX5300_USE_CHECKSUM);
+  Handler->Batch.Feedback = Feedback;
+  Handler->Batch.Count++;
+
+  return YX5300_OK;
+}
+#endif
+
+
+static YX5300_Result_t
+YX5300_SendCommand(YX5300_Handler_t *Handler,
+                   uint8_t Command, uint8_t Data1, uint8_t Data2)
+{
+  uint8_t Feedback = YX5300_CMD_FEEDBACK;
+#if (YX5300_USE_BATCH || YX5300_USE_TX_QUEUE)
+  YX5300_Result_t Result = YX5300_OK;
+#endif
+#if (YX5300_USE_TX_QUEUE && YX5300_USE_TX_PRIORITY)
+  uint8_t Urgent = 0;
+#endif
+
+  YX5300_Lock(Handler);
+
+  if (Handler->Feedback.Next != YX5300_FEEDBACK_DEFAULT)
+  {
+    if (Handler->Feedback.Next == YX5300_FEEDBACK_DISABLE)
+      Feedback = YX5300_CMD_NOT_FEEDBACK;
+    Handler->Feedback.Next = YX5300_FEEDBACK_DEFAULT;
+  }
+  else if (Handler->Feedback.Default == YX5300_FEEDBACK_DISABLE)
+  {
+    Feedback = YX5300_CMD_NOT_FEEDBACK;
+  }
+
+#if (YX5300_USE_TX_QUEUE && YX5300_USE_TX_PRIORITY)
+  Urgent = (Handler->Tx.NextUrgent ||
+            Command == YX5300_CMD_STOP || Command == YX5300_CMD_PAUSE);
+  Handler->Tx.NextUrgent = 0;
+#endif
+
+#if (YX5300_USE_TX_QUEUE && YX5300_USE_FADE)
+  // Volume commands of user stop the fade
+  if (Command == YX5300_CMD_VOL_SET || Command == YX5300_CMD_VOL_UP ||
+      Command == YX5300_CMD_VOL_DOWN || Command == YX5300_CMD_PLAY_WITH_VOL)
+    Handler->Fade.Active = 0;
+#endif
+
+#if (YX5300_USE_CACHE)
+  if (YX5300_CacheIsRedundant(Handler, Command, Data1, Data2))
+  {
+    YX5300_Unlock(Handler);
+    return YX5300_OK;
+  }
+
+  // Values changed by the command are unknown until it is confirmed
+  Handler->Cache.Valid &= ~YX5300_CacheMask(Command);
+#endif
+
+#if (YX5300_USE_BATCH)
+  if (Handler->Batch.State == YX5300_BATCH_RECORDING)
+  {
+    Result = YX5300_BatchAdd(Handler, Command, Feedback, Data1, Data2);
+    YX5300_Unlock(Handler);
+    return Result;
+  }
+#endif
+
+#if (YX5300_USE_TX_QUEUE)
+#if (YX5300_USE_TX_PRIORITY)
+  if (Urgent)
+    Result = YX5300_TxPushUrgent(Handler, Command, Feedback, Data1, Data2);
+  else
+    Result = YX5300_TxPush(Handler, Command, Feedback, Data1, Data2);
+#else
+  Result = YX5300_TxPush(Handler, Command, Feedback, Data1, Data2);
+#endif
+
+  YX5300_Unlock(Handler);
+  return Result;
+#else
+  YX5300_Unlock(Handler);
+  return YX5300_TransmitCommand(Handler, Command, Feedback, Data1, Data2);
+#endif
+}
+
+
+#if (YX5300_USE_PLAYLIST)
+static YX5300_Result_t
+YX5300_PlaylistOnSend(YX5300_Handler_t *Handler, YX5300_Result_t Result)
+{
+  uint32_t Tick = 0;
+
+  if (Result != YX5300_OK)
+    return Result;
+
+  if (Handler->Platform.GetTick)
+    Tick = Handler->Platform.GetTick(Handler->Platform.UserCtx);
+
+  // One completion is taken for each play command
+  YX5300_Lock(Handler);
+  Handler->Playlist.Pending = 1;
+  Handler->Playlist.PlayTick = Tick;
+  YX5300_Unlock(Handler);
+
+  return Result;
+}
+
+
+static YX5300_Result_t
+YX5300_PlaylistPlayFile(YX5300_Handler_t *Handler, uint8_t Folder, uint16_t File)
+{
+  YX5300_Result_t Result = YX5300_OK;
+
+  if (Folder == 0)
+    Result = YX5300_SendCommand(Handler, YX5300_CMD_PLAY_INDEX,
+                                (uint8_t)(File >> 8), (uint8_t)(File & 0xFF));
+  else if (File == 0) // The module repeats the folder itself
+    Result = YX5300_SendCommand(Handler, YX5300_CMD_PLAY_CYCLE_FOLD, Folder, 0);
+  else
+    Result = YX5300_SendCommand(Handler, YX5300_CMD_PLAY_FOLD_FILE,
+                                Folder, (uint8_t)File);
+
+  return YX5300_PlaylistOnSend(Handler, Result);
+}
+
+
+static YX5300_Result_t
+YX5300_PlaylistPlayItem(YX5300_Handler_t *Handler,
+                        uint8_t Folder, uint16_t File, uint8_t Volume)
+{
+  YX5300_Result_t Result = YX5300_OK;
+#if (YX5300_USE_TX_QUEUE && YX5300_USE_FADE && YX5300_PLAYLIST_FADE_TIME > 0)
+  uint32_t Tick = 0;
+#endif
+
+#if (YX5300_USE_TX_QUEUE && YX5300_USE_FADE && YX5300_PLAYLIST_FADE_TIME > 0)
+  if (Volume != 0)
+  {
+    // The item fades in from silence
+    Result = YX5300_SendCommand(Handler, YX5300_CMD_VOL_SET, 0, 0);
+    if (Result != YX5300_OK)
+      return Result;
+
+    Result = YX5300_PlaylistPlayFile(Handler, Folder, File);
+    if (Result != YX5300_OK)
+      return Result;
+
+    Tick = Handler->Platform.GetTick(Handler->Platform.UserCtx);
+    YX5300_Lock(Handler);
+    YX5300_FadeStart(Handler, Tick, 0, Volume, YX5300_PLAYLIST_FADE_TIME);
+    YX5300_Unlock(Handler);
+    return YX5300_OK;
+  }
+#endif
+
+  // Track and volume are sent in one frame if it is possible
+  if (Volume != 0 && Folder == 0 && File <= 0xFF)
+    return YX5300_PlaylistOnSend(Handler,
+                                 YX5300_SendCommand(Handler, YX5300_CMD_PLAY_WITH_VOL,
+                                                    Volume, (uint8_t)File));
+
+  if (Volume != 0)
+  {
+    Result = YX5300_SendCommand(Handler, YX5300_CMD_VOL_SET, 0, Volume);
+    if (Result != YX5300_OK)
+      return Result;
+  }
+
+  return YX5300_PlaylistPlayFile(Handler, Folder, File);
+}
+
+
+static uint8_t
+YX5300_PlaylistRandom(YX5300_Handler_t *Handler)
+{
+  uint32_t x = Handler->Playlist.Seed;
+
+  // xorshift32
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  Handler->Playlist.Seed = x;
+
+  return (uint8_t)(x % Handler->Playlist.Count);
+}
+
+
+static inline void
+YX5300_PlaylistGetItem(YX5300_Handler_t *Handler,
+                       uint8_t *Folder, uint16_t *File, uint8_t *Volume)
+{
+  *Folder = Handler->Playlist.Items[Handler->Playlist.Index].Folder;
+  *File = Handler->Playlist.Items[Handler->Playlist.Index].File;
+  *Volume = Handler->Playlist.Items[Handler->Playlist.Index].Volume;
+}
+
+
+// Must be called with the lock held, the item is returned to be played after
+// unlocking
+static uint8_t
+YX5300_PlaylistAdvance(YX5300_Handler_t *Handler,
+                       uint8_t *Folder, uint16_t *File, uint8_t *Volume)
+{
+  uint8_t Index = Handler->Playlist.Index;
+
+  if (Handler->Playlist.Count == 0)
+  {
+    Handler->Playlist.Active = 0;
+    return 0;
+  }
+
+  switch (Handler->Playlist.Mode)
+  {
+  case YX5300_PLAYMODE_SHUFFLE:
+    if (Handler->Playlist.Count > 1)
+    {
+      do
+      {
+        Index = YX5300_PlaylistRandom(Handler);
+      } while (Index == Handler->Playlist.Index);
+    }
+    break;
+
+  case YX5300_PLAYMODE_REPEAT:
+    Index = (Index + 1) % Handler->Playlist.Count;
+    break;
+
+  default:
+    Index++;
+    if (Index >= Handler->Playlist.Count)
+    {
+      Handler->Playlist.Active = 0;
+      return 0;
+    }
+    break;
+  }
+
+  Handler->Playlist.Index = Index;
+  YX5300_PlaylistGetItem(Handler, Folder, File, Volume);
+  return 1;
+}
+
+
+static void
+YX5300_PlaylistOnResponse(YX5300_Handler_t *Handler, uint8_t Response)
+{
+  uint32_t Tick = 0;
+  uint8_t Duplicate = 0;
+  uint8_t Play = 0;
+  uint8_t Folder = 0;
+  uint8_t Volume = 0;
+  uint16_t File = 0;
+
+  if (Response != 0x3D)
+    return;
+
+  if (Handler->Platform.GetTick)
+    Tick = Handler->Platform.GetTick(Handler->Platform.UserCtx);
+
+  YX5300_Lock(Handler);
+
+  // Module may send the "completed play" response twice back-to-back. Only the
+  // first completion after a play command is taken, and a completion that
+  // comes right after the play command belongs to the previous item.
+  if (!Handler->Playlist.Pending)
+    Duplicate = 1;
+  else if (Handler->Platform.GetTick &&
+           (uint32_t)(Tick - Handler->Playlist.PlayTick) < YX5300_PLAYLIST_MIN_TRACK)
+    Duplicate = 1;
+  else
+    Handler->Playlist.Pending = 0;
+
+  // A repeated folder is played until YX5300_PlaylistNext is called
+  if (!Duplicate && Handler->Playlist.Active &&
+      (Handler->Playlist.Items[Handler->Playlist.Index].Folder == 0 ||
+       Handler->Playlist.Items[Handler->Playlist.Index].File != 0))
+    Play = YX5300_PlaylistAdvance(Handler, &Folder, &File, &Volume);
+
+  YX5300_Unlock(Handler);
+
+  if (Play)
+    YX5300_PlaylistPlayItem(Handler, Folder, File, Volume);
+}
+#endif
+
+
+#if (YX5300_USE_LIBRARY)
+static uint8_t
+YX5300_LibraryArm(YX5300_Handler_t *Handler, uint8_t Command)
+{
+  // The response code of query commands is the same as the command code
+  Handler->Library.Pending = Command;
+  Handler->Library.Retries = 0;
+  if (Handler->Platform.GetTick)
+    Handler->Library.SendTick = Handler->Platform.GetTick(Handler->Platform.UserCtx);
+  return Command;
+}
+
+
+static uint8_t
+YX5300_LibraryRestart(YX5300_Handler_t *Handler)
+{
+  // The table is kept until the total tracks is compared with its key
+  Handler->Library.Next = 0;
+  Handler->Library.State = YX5300_LIBRARY_SCANNING;
+  return YX5300_LibraryArm(Handler, YX5300_CMD_QUERY_TOT_TRACKS);
+}
+
+
+static uint8_t
+YX5300_LibraryQueryNext(YX5300_Handler_t *Handler)
+{
+  if (Handler->Library.Next > Handler->Library.Folders)
+  {
+    Handler->Library.Total = Handler->Status.TotalTracks;
+    Handler->Library.Pending = 0;
+    Handler->Library.State = YX5300_LIBRARY_READY;
+    return 0;
+  }
+
+  return YX5300_LibraryArm(Handler, YX5300_CMD_QUERY_FLDR_TRACKS);
+}
+
+
+static inline uint8_t
+YX5300_LibraryQueryData(YX5300_Handler_t *Handler, uint8_t Command)
+{
+  return (Command == YX5300_CMD_QUERY_FLDR_TRACKS) ? Handler->Library.Next : 0;
+}
+
+
+static YX5300_Result_t
+YX5300_LibrarySend(YX5300_Handler_t *Handler, uint8_t Command, uint8_t Data2)
+{
+  YX5300_Result_t Result = YX5300_OK;
+
+  Result = YX5300_SendCommand(Handler, Command, 0, Data2);
+  if (Result != YX5300_OK)
+  {
+    YX5300_Lock(Handler);
+    if (Handler->Library.Pending == Command)
+    {
+      Handler->Library.Pending = 0;
+      Handler->Library.State = YX5300_LIBRARY_EMPTY;
+    }
+    YX5300_Unlock(Handler);
+  }
+
+  return Result;
+}
+
+
+static YX5300_Result_t
+YX5300_LibraryStart(YX5300_Handler_t *Handler)
+{
+  uint8_t Command = 0;
+
+  YX5300_Lock(Handler);
+  Command = YX5300_LibraryRestart(Handler);
+  YX5300_Unlock(Handler);
+
+  return YX5300_LibrarySend(Handler, Command, 0);
+}
+
+
+static uint8_t
+YX5300_LibraryOnResponse(YX5300_Handler_t *Handler,
+                         uint8_t Response, uint16_t Data, uint8_t Command)
+{
+  if (Handler->Library.Table == NULL ||
+      Handler->Library.Pending == YX5300_LIBRARY_INIT)
+    return 0;
+
+  switch (Response)
+  {
+  case 0x3A: // Memory card inserted
+  case 0x3F: // Initialization done
+    // A running scan may belong to another card, so it is started again
+    return YX5300_LibraryRestart(Handler);
+
+  case 0x3B: // Memory card removed
+    // The table is kept, it is used again if the same card is inserted
+    Handler->Library.Pending = 0;
+    Handler->Library.State = YX5300_LIBRARY_EMPTY;
+    return 0;
+
+  case 0x40: // Error
+    if (Handler->Library.Pending == 0 || Command != Handler->Library.Pending)
+      return 0;
+    // The folder may not exist
+    if (Handler->Library.Pending == YX5300_CMD_QUERY_FLDR_TRACKS)
+    {
+      Handler->Library.Table[Handler->Library.Next - 1] = 0;
+      Handler->Library.Next++;
+      return YX5300_LibraryQueryNext(Handler);
+    }
+    Handler->Library.Pending = 0;
+    Handler->Library.State = YX5300_LIBRARY_EMPTY;
+    return 0;
+
+  default:
+    break;
+  }
+
+  if (Handler->Library.Pending == 0 || Response != Handler->Library.Pending)
+    return 0;
+
+  switch (Response)
+  {
+  case 0x48: // Total tracks
+    if (Handler->Library.Total != 0 && Handler->Library.Total == Data)
+    {
+      Handler->Library.Pending = 0;
+      Handler->Library.State = YX5300_LIBRARY_READY;
+      return 0;
+    }
+    Handler->Library.Folders = 0;
+    Handler->Library.Total = 0;
+    return YX5300_LibraryArm(Handler, YX5300_CMD_QUERY_FLDR_COUNT);
+
+  case 0x4F: // Folder count
+    Handler->Library.Folders = (Data < Handler->Library.Size) ?
+                               (uint8_t)Data : Handler->Library.Size;
+    Handler->Library.Next = 1;
+    return YX5300_LibraryQueryNext(Handler);
+
+  case 0x4E: // Folder file count
+    Handler->Library.Table[Handler->Library.Next - 1] =
+        (Data < 0xFF) ? (uint8_t)Data : 0xFF;
+    Handler->Library.Next++;
+    return YX5300_LibraryQueryNext(Handler);
+
+  default:
+    return 0;
+  }
+}
+
+
+static uint8_t
+YX5300_LibraryOnTick(YX5300_Handler_t *Handler, uint32_t Tick)
+{
+  if (Handler->Library.State != YX5300_LIBRARY_SCANNING ||
+      Handler->Library.Pending == 0 ||
+      Handler->Library.Pending == YX5300_LIBRARY_INIT)
+    return 0;
+
+#if (YX5300_USE_TX_QUEUE)
+  // The time is not counted while the query waits in Tx queue
+  if (YX5300_TxPending(Handler) != 0)
+  {
+    Handler->Library.SendTick = Tick;
+    return 0;
+  }
+#endif
+
+  if ((uint32_t)(Tick - Handler->Library.SendTick) < YX5300_LIBRARY_TIMEOUT)
+    return 0;
+
+  // The query or its reply is lost
+  if (Handler->Library.Retries >= YX5300_LIBRARY_RETRIES)
+  {
+    Handler->Library.Pending = 0;
+    Handler->Library.State = YX5300_LIBRARY_EMPTY;
+    return 0;
+  }
+
+  Handler->Library.Retries++;
+  Handler->Library.SendTick = Tick;
+  return Handler->Library.Pending;
+}
+
+
+static YX5300_Result_t
+YX5300_LibraryProcess(YX5300_Handler_t *Handler)
+{
+  uint32_t Tick = 0;
+  uint8_t Command = 0;
+  uint8_t Data2 = 0;
+
+  if (Handler->Platform.GetTick == NULL)
+    return YX5300_OK;
+
+  Tick = Handler->Platform.GetTick(Handler->Platform.UserCtx);
+
+  YX5300_Lock(Handler);
+  Command = YX5300_LibraryOnTick(Handler, Tick);
+  Data2 = YX5300_LibraryQueryData(Handler, Command);
+  YX5300_Unlock(Handler);
+
+  if (Command == 0)
+    return YX5300_OK;
+
+  return YX5300_LibrarySend(Handler, Command, Data2);
+}
+#endif
+
+
+#if (YX5300_USE_POSITION)
+static uint16_t
+YX5300_PositionFolderTrack(YX5300_Handler_t *Handler, uint8_t Folder, uint8_t File)
+{
+#if (YX5300_USE_LIBRARY)
+  uint16_t Track = File;
+  uint8_t i = 0;
+
+  if (Handler->Library.State != YX5300_LIBRARY_READY ||
+      Folder == 0 || Folder > Handler->Library.Folders ||
+      File == 0 || File > Handler->Library.Table[Folder - 1])
+    return 0;
+
+  for (i = 0; i < Folder - 1; i++)
+    Track += Handler->Library.Table[i];
+
+  return Track;
+#else
+  (void)Handler;
+  (void)Folder;
+  (void)File;
+  return 0;
+#endif
+}
+
+
+static void
+YX5300_PositionStart(YX5300_Handler_t *Handler, uint32_t Tick,
+                     uint16_t Track, uint8_t Cycle)
+{
+  Handler->Position.StartTick = Tick;
+  Handler->Position.Track = Track;
+  Handler->Position.Cycle = Cycle;
+  Handler->Position.State = 0x01;
+}
+
+
+static void
+YX5300_PositionOnAck(YX5300_Handler_t *Handler, uint32_t Tick)
+{
+  uint8_t Data1 = (uint8_t)(Handler->Status.LastCommandData >> 8);
+  uint8_t Data2 = (uint8_t)(Handler->Status.LastCommandData & 0xFF);
+  uint16_t Track = Handler->Position.Track;
+  uint16_t Total = Handler->Status.TotalTracks;
+
+  switch (Handler->Status.LastCommand)
+  {
+  case YX5300_CMD_PLAY_INDEX:
+    YX5300_PositionStart(Handler, Tick, Handler->Status.LastCommandData,
+                         YX5300_POSITION_CYCLE_NONE);
+    break;
+
+  case YX5300_CMD_SINGLE_CYCLE:
+    YX5300_PositionStart(Handler, Tick, Handler->Status.LastCommandData,
+                         YX5300_POSITION_CYCLE_TRACK);
+    break;
+
+  case YX5300_CMD_PLAY_WITH_VOL:
+    YX5300_PositionStart(Handler, Tick, Data2, YX5300_POSITION_CYCLE_NONE);
+    break;
+
+  case YX5300_CMD_PLAY_FOLD_FILE:
+    YX5300_PositionStart(Handler, Tick, YX5300_PositionFolderTrack(Handler, Data1, Data2),
+                         YX5300_POSITION_CYCLE_NONE);
+    break;
+
+  case YX5300_CMD_PLAY_CYCLE_FOLD:
+    // The folder is played from its first file
+    YX5300_PositionStart(Handler, Tick, YX5300_PositionFolderTrack(Handler, Data1, 1),
+                         YX5300_POSITION_CYCLE_FOLDER);
+    break;
+
+  case YX5300_CMD_NEXT:
+  case YX5300_CMD_PREV:
+    if (Track != 0 && Total != 0)
+    {
+      if (Handler->Status.LastCommand == YX5300_CMD_NEXT)
+        Track = (Track >= Total) ? 1 : Track + 1;
+      else
+        Track = (Track <= 1) ? Total : Track - 1;
+    }
+    else
+    {
+      Track = 0;
+    }
+    YX5300_PositionStart(Handler, Tick, Track, Handler->Position.Cycle);
+    break;
+
+  case YX5300_CMD_PLAY:
+    if (Handler->Position.State == 0x02)
+    {
+      // Pause time does not count
+      Handler->Position.StartTick += Tick - Handler->Position.PauseTick;
+      Handler->Position.State = 0x01;
+    }
+    else if (Handler->Position.State == 0x00)
+    {
+      YX5300_PositionStart(Handler, Tick, Track, Handler->Position.Cycle);
+    }
+    break;
+
+  case YX5300_CMD_PAUSE:
+    if (Handler->Position.State == 0x01)
+    {
+      Handler->Position.PauseTick = Tick;
+      Handler->Position.State = 0x02;
+    }
+    break;
+
+  case YX5300_CMD_SET_SNGL_CYCL:
+    // Data 0 starts and data 1 stops the repeat of current track
+    Handler->Position.Cycle = (Data2 == 0) ?
+                              YX5300_POSITION_CYCLE_TRACK : YX5300_POSITION_CYCLE_NONE;
+    break;
+
+  case YX5300_CMD_STOP:
+  case YX5300_CMD_SLEEP_MODE:
+    Handler->Position.State = 0x00;
+    break;
+
+  case YX5300_CMD_RESET:
+    Handler->Position.State = 0x00;
+    Handler->Position.Track = 0;
+    Handler->Position.Cycle = YX5300_POSITION_CYCLE_NONE;
+    break;
+
+  default:
+    break;
+  }
+}
+
+
+static void
+YX5300_PositionOnResponse(YX5300_Handler_t *Handler, uint8_t Acked)
+{
+  uint32_t Tick = 0;
+
+  if (Handler->Platform.GetTick == NULL)
+    return;
+
+  switch (Handler->Status.LastResponse)
+  {
+  case 0x41: // Data received correctly
+    // Only the ACK of the command that is waiting for it is credited
+    if (!Acked)
+      break;
+    Tick = Handler->Platform.GetTick(Handler->Platform.UserCtx);
+    YX5300_PositionOnAck(Handler, Tick);
+    break;
+
+  case 0x3D: // Completed play
+    Tick = Handler->Platform.GetTick(Handler->Platform.UserCtx);
+    if (Handler->Position.State == 0x01 &&
+        Handler->Position.Cycle != YX5300_POSITION_CYCLE_NONE)
+    {
+      // The response is sent twice, so the second one must not restart the
+      // repeated track again
+      if ((uint32_t)(Tick - Handler->Position.StartTick) < YX5300_POSITION_MIN_TRACK)
+        break;
+      if (Handler->Position.Cycle == YX5300_POSITION_CYCLE_FOLDER)
+        Handler->Position.Track = 0;
+      Handler->Position.StartTick = Tick;
+    }
+    else
+    {
+      Handler->Position.State = 0x00;
+      Handler->Position.Track = 0;
+    }
+    break;
+
+  case 0x3A: // Memory card inserted
+  case 0x3B: // Memory card removed
+  case 0x3F: // Initialization done
+    Handler->Position.State = 0x00;
+    Handler->Position.Track = 0;
+    Handler->Position.Cycle = YX5300_POSITION_CYCLE_NONE;
+    break;
+
+  default:
+    break;
+  }
+}
+#endif
+
+
+#if (YX5300_USE_STATS)
+static void
+YX5300_StatsOnAck(YX5300_Handler_t *Handler)
+{
+  YX5300_Stats_t *Stats = &Handler->Stats.Counters;
+  uint32_t Latency = 0;
+
+  if (!Handler->Stats.WaitAck)
+    return;
+  Handler->Stats.WaitAck = 0;
+
+  Latency = Handler->Platform.GetTick(Handler->Platform.UserCtx) -
+            Handler->Stats.SendTick;
+  if (Latency > 0xFFFF)
+    Latency = 0xFFFF;
+
+  if (Stats->AckCount == 0 || Latency < Stats->AckLatencyMin)
+    Stats->AckLatencyMin = (uint16_t)Latency;
+  if (Latency > Stats->AckLatencyMax)
+    Stats->AckLatencyMax = (uint16_t)Latency;
+  Stats->AckLatencySum += Latency;
+  Stats->AckCount++;
+}
+#endif
+
+
+static YX5300_Result_t
+YX5300_ParseResponse(YX5300_Handler_t *Handler)
+{
+  YX5300_Event_t Event = {0};
+  YX5300_Result_t Result = YX5300_OK;
+  uint8_t Response = 0;
+  uint16_t Data = 0;
+  uint8_t Command = 0;
+#if (YX5300_USE_TX_QUEUE)
+  uint8_t Acked = 0;
+#endif
+#if (YX5300_USE_LIBRARY)
+  uint8_t Query = 0;
+  uint8_t QueryData = 0;
+#endif
+
+  // Response Structure  0x7E 0xFF 0x06 RSP 0x00 0x00 DAT 0xFE 0xBA 0xEF
+  // RSP: Response code
+  // DAT: Data
+
+  YX5300_Lock(Handler);
+  YX5300_StatusWriteBegin(Handler);
+  YX5300_STATS_INC(Handler, FramesReceived);
+
+  Handler->Status.LastResponse = Handler->Rx.Buffer[3];
+  Handler->Status.LastResponseData = (Handler->Rx.Buffer[5] << 8) | Handler->Rx.Buffer[6];
+
+  switch (Handler->Status.LastResponse)
+  {
+  case 0x3A: // Memory card inserted
+    Handler->Status.MemoryInserted = 1;
+    Event.Type = YX5300_EVENT_CARD_INSERTED;
+    break;
+
+  case 0x3B: // Memory card removed
+    Handler->Status.MemoryInserted = 0;
+    Event.Type = YX5300_EVENT_CARD_REMOVED;
+    break;
+
+  case 0x3D: // Completed play num 'DAT'
+    Handler->Status.Track = 0;
+    Event.Type = YX5300_EVENT_TRACK_FINISHED;
+    break;
+
+  case 0x3F: // Initialization done, online devices 'DAT'
+    Handler->Status.MemoryInserted = (Handler->Status.LastResponseData & 0x02) ? 1 : 0;
+#if (YX5300_USE_TX_QUEUE && YX5300_USE_FADE)
+    Handler->Fade.Current = YX5300_FADE_UNKNOWN;
+#endif
+    Event.Type = YX5300_EVENT_INIT_DONE;
+    break;
+
+  case 0x40: // Error
+#if (YX5300_USE_TX_QUEUE)
+#if (YX5300_USE_TX_RETRY)
+    YX5300_TxOnError(Handler);
+#endif
+    // An unsolicited response must not end the gap of a command without
+    // feedback
+    if (Handler->Tx.WaitAck == 1)
+      Handler->Tx.WaitAck = 0;
+#endif
+#if (YX5300_USE_STATS)
+    Handler->Stats.WaitAck = 0;
+#endif
+    YX5300_STATS_INC(Handler, ErrorResponses);
+    Event.Type = YX5300_EVENT_ERROR;
+    break;
+
+  case 0x41: // Data received correctly
+#if (YX5300_USE_TX_QUEUE)
+#if (YX5300_USE_TX_RETRY)
+    YX5300_TxOnAck(Handler);
+#endif
+    Acked = (Handler->Tx.WaitAck == 1);
+    if (Acked)
+      Handler->Tx.WaitAck = 0;
+#endif
+#if (YX5300_USE_STATS)
+    YX5300_StatsOnAck(Handler);
+#endif
+    Event.Type = YX5300_EVENT_ACK;
+    break;
+
+  case 0x42: // Status 'DAT'
+    Handler->Status.StatusByte = Handler->Status.LastResponseData;
+    if (Handler->Status.StatusByte == 0x00)
+      Handler->Status.Track = 0;
+    Event.Type = YX5300_EVENT_STATUS;
+    break;
+
+  case 0x43: // Vol playing 'DAT'
+    Handler->Status.Volume = Handler->Status.LastResponseData;
+#if (YX5300_USE_TX_QUEUE && YX5300_USE_FADE)
+    // The reply is the current volume only if no command is waiting
+    if (YX5300_TxPending(Handler) == 0 && Handler->Status.Volume <= 30)
+      Handler->Fade.Current = Handler->Status.Volume;
+#endif
+    Event.Type = YX5300_EVENT_VOLUME;
+    break;
+
+  case 0x48: // File count 'DAT'
+    Handler->Status.TotalTracks = Handler->Status.LastResponseData;
+    Event.Type = YX5300_EVENT_TOTAL_TRACKS;
+    break;
+
+  case 0x4C: // Playing track 'DAT'
+    Handler->Status.Track = Handler->Status.LastResponseData;
+    Event.Type = YX5300_EVENT_TRACK;
+    break;
+
+  case 0x4E: // Folder file count 'DAT'
+    Event.Type = YX5300_EVENT_FOLDER_TRACKS;
+    break;
+
+  case 0x4F: // Folder file 'DAT'
+    Event.Type = YX5300_EVENT_FOLDER_COUNT;
+    break;
+
+  default: // Unrecognized response
+    YX5300_STATS_INC(Handler, ParseFailures);
+    Result = YX5300_FAIL;
+    break;
+  }
+
+#if (YX5300_USE_CACHE)
+  if (Result == YX5300_OK)
+    YX5300_CacheOnResponse(Handler, Acked);
+#endif
+
+#if (YX5300_USE_TX_QUEUE && YX5300_USE_TX_COALESCE)
+  if (Result == YX5300_OK)
+    YX5300_TxOnResponse(Handler);
+#endif
+
+#if (YX5300_USE_POSITION)
+  if (Result == YX5300_OK)
+    YX5300_PositionOnResponse(Handler, Acked);
+#endif
+
+  // The status may be changed by another context after unlocking
+  Response = Handler->Status.LastResponse;
+  Data = Handler->Status.LastResponseData;
+  Command = Handler->Status.LastCommand;
+
+#if (YX5300_USE_LIBRARY)
+  // Next query of the scan is sent after unlocking
+  if (Result == YX5300_OK)
+  {
+    Query = YX5300_LibraryOnResponse(Handler, Response, Data, Command);
+    QueryData = YX5300_LibraryQueryData(Handler, Query);
+  }
+#endif
+
+  YX5300_StatusWriteEnd(Handler);
+  YX5300_Unlock(Handler);
+
+  if (Result != YX5300_OK)
+    return Result;
+
+  if (Handler->Wait.Code[0] == Response || Handler->Wait.Code[1] == Response)
+    Handler->Wait.Received = Response;
+
+#if (YX5300_USE_PLAYLIST)
+  YX5300_PlaylistOnResponse(Handler, Response);
+#endif
+
+#if (YX5300_USE_LIBRARY)
+  if (Query != 0)
+    YX5300_LibrarySend(Handler, Query, QueryData);
+#endif
+
+#if (YX5300_USE_EVENTS)
+  if (Handler->EventCallback)
+  {
+    Event.Response = Response;
+    Event.Command = Command;
+    Event.Data = Data;
+    Handler->EventCallback(Handler, &Event);
+  }
+#else
+  (void)Event;
+  (void)Data;
+  (void)Command;
+#endif
+
+  return YX5300_OK;
+}
+
+
+static inline YX5300_Result_t
+YX5300_RxByte(YX5300_Handler_t *Handler, uint8_t Data)
+{
+  switch (YX5300_CodecDecode(&Handler->Rx, Data, YX5300_RX_SHORT_FRAMES))
+  {
+  case YX5300_DECODE_FRAME:
+    if (YX5300_ParseResponse(Handler) != YX5300_OK)
+      return YX5300_FAIL;
+    return YX5300_RX_COMPLETE;
+
+  case YX5300_DECODE_DROP:
+    YX5300_STATS_INC(Handler, Resyncs);
+    return YX5300_FAIL;
+
+  default:
+    return YX5300_OK;
+  }
+}
+
+
+static uint8_t
+YX5300_ReceivePending(YX5300_Handler_t *Handler)
+{
+  uint8_t Buffer[YX5300_RESPONSE_SIZE];
+  uint8_t Len = 0;
+
+  if (Handler->Platform.Receive == NULL ||
+      Handler->Platform.Receive(Handler->Platform.UserCtx,
+                                Buffer, sizeof(Buffer), &Len) != 0)
+    return 0;
+
+  YX5300_RxBuffer(Handler, Buffer, Len, NULL);
+
+  return Len;
+}
+
+
+static inline void
+YX5300_WaitStart(YX5300_Handler_t *Handler, uint8_t Code1, uint8_t Code2)
+{
+  Handler->Wait.Received = 0;
+  Handler->Wait.Code[0] = Code1;
+  Handler->Wait.Code[1] = Code2;
+}
+
+
+static inline void
+YX5300_WaitStop(YX5300_Handler_t *Handler)
+{
+  Handler->Wait.Code[0] = 0;
+  Handler->Wait.Code[1] = 0;
+}
+
+
+static YX5300_Result_t
+YX5300_WaitResponse(YX5300_Handler_t *Handler, uint16_t Timeout)
+{
+  uint8_t Len = 0;
+  uint32_t StartTick = 0;
+  uint32_t Elapsed = 0;
+
+  if (Handler->Platform.GetTick)
+    StartTick = Handler->Platform.GetTick(Handler->Platform.UserCtx);
+
+  while (!Handler->Wait.Received)
+  {
+    YX5300_Process(Handler);
+
+    Len = YX5300_ReceivePending(Handler);
+
+    if (Handler->Wait.Received)
+      break;
+
+    if (Len == 0)
+    {
+      // The elapsed time is counted by the delays if there is no tick
+      if (Handler->Platform.Yield && Handler->Platform.GetTick)
+        Handler->Platform.Yield(Handler->Platform.UserCtx);
+      else
+        Handler->Platform.Delay(Handler->Platform.UserCtx, 1);
+      if (!Handler->Platform.GetTick)
+        Elapsed++;
+    }
+
+    if (Handler->Platform.GetTick)
+      Elapsed = Handler->Platform.GetTick(Handler->Platform.UserCtx) -
+                StartTick;
+
+    if (Elapsed >= Timeout)
+    {
+      YX5300_WaitStop(Handler);
+      return YX5300_TIMEOUT;
+    }
+  }
+
+  YX5300_WaitStop(Handler);
+  return YX5300_OK;
+}
+
+
+#if (!YX5300_USE_FAST_INIT)
+static void
+YX5300_WaitFor(YX5300_Handler_t *Handler, uint16_t Time)
+{
+  // Keep parsing the received data until the deadline if it is possible
+  if (Handler->Platform.Receive == NULL || Handler->Platform.GetTick == NULL)
+  {
+    Handler->Platform.Delay(Handler->Platform.UserCtx, Time);
+    return;
+  }
+
+  YX5300_WaitStart(Handler, 0, 0);
+  YX5300_WaitResponse(Handler, Time);
+}
+#endif
+
+
+static YX5300_Result_t
+YX5300_Query(YX5300_Handler_t *Handler, uint8_t Command, uint16_t Timeout)
+{
+  YX5300_Result_t Result = YX5300_OK;
+
+#if (YX5300_USE_CACHE)
+  if (YX5300_CacheIsFresh(Handler, Command))
+    return YX5300_OK;
+#endif
+
+#if (YX5300_USE_BATCH)
+  // The response would not come before the batch is sent
+  if (Handler->Batch.State == YX5300_BATCH_RECORDING)
+    return YX5300_FAIL;
+#endif
+
+  // The response code of query commands is the same as the command code
+  YX5300_WaitStart(Handler, Command, 0);
+
+  Result = YX5300_SendCommand(Handler, Command, 0, 0);
+  if (Result != YX5300_OK)
+  {
+    YX5300_WaitStop(Handler);
+    return Result;
+  }
+
+  return YX5300_WaitResponse(Handler, Timeout);
+}
+
+
+#if (YX5300_USE_FAST_INIT)
+static YX5300_Result_t
+YX5300_InitCommand(YX5300_Handler_t *Handler, uint8_t Command, uint8_t Data2,
+                   uint8_t Code1, uint8_t Code2, uint16_t Timeout)
+{
+  YX5300_WaitStart(Handler, Code1, Code2);
+
+  if (YX5300_TransmitCommand(Handler, Command,
+                             YX5300_CMD_FEEDBACK, 0, Data2) != YX5300_OK)
+  {
+    YX5300_WaitStop(Handler);
+    return YX5300_FAIL;
+  }
+
+  return YX5300_WaitResponse(Handler, Timeout);
+}
+#endif
+
+
+
+/**
+ ==================================================================================
+                            ##### Public Functions #####                           
+ ==================================================================================
+ */
+
+/**
+ * @brief  Initializer function
+ * @note   This function must be called after initializing platform dependent
+ *         layer and before using other functions.
+ * @note   If YX5300_USE_FAST_INIT is enabled, the device selection is checked
+ *         too, so a missing module or memory card is reported.
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data, or the module reported
+ *                        an error for the device selection (no memory card).
+ *         - YX5300_TIMEOUT: The module did not answer the device selection
+ *                           (only if YX5300_USE_FAST_INIT is enabled).
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_Init(YX5300_Handler_t *Handler)
+{
+  YX5300_Result_t Result = YX5300_OK;
+
+  if (Handler == NULL)
+    return YX5300_INVALID_PARAM;
+
+  if (Handler->Platform.Delay == NULL ||
+      Handler->Platform.Send == NULL)
+    return YX5300_INVALID_PARAM;
+
+#if (YX5300_USE_TX_QUEUE)
+  if (Handler->Platform.GetTick == NULL)
+    return YX5300_INVALID_PARAM;
+
+  Handler->Tx.Head = 0;
+  Handler->Tx.Tail = 0;
+  Handler->Tx.Count = 0;
+  Handler->Tx.WaitAck = 0;
+  Handler->Tx.Sending = 0;
+#if (YX5300_USE_FADE)
+  Handler->Fade.Active = 0;
+  Handler->Fade.Current = YX5300_FADE_UNKNOWN;
+#endif
+#if (YX5300_USE_TX_PRIORITY)
+  Handler->Tx.UrgentHead = 0;
+  Handler->Tx.UrgentTail = 0;
+  Handler->Tx.UrgentCount = 0;
+  Handler->Tx.NextUrgent = 0;
+#endif
+#if (YX5300_USE_TX_COALESCE)
+  Handler->Tx.Known = 0;
+#endif
+#if (YX5300_USE_TX_RETRY)
+  Handler->Tx.Retry = 0;
+  Handler->Tx.Retries = 0;
+  Handler->Tx.Srtt = 0;
+  Handler->Tx.Rttvar = 0;
+#endif
+#endif
+
+#if (YX5300_USE_CACHE)
+  Handler->Cache.Valid = 0;
+#endif
+
+#if (YX5300_USE_BATCH)
+  Handler->Batch.Count = 0;
+  Handler->Batch.Sent = 0;
+  Handler->Batch.State = YX5300_BATCH_IDLE;
+#endif
+
+#if (YX5300_USE_POSITION)
+  Handler->Position.Track = 0;
+  Handler->Position.State = 0x00;
+  Handler->Position.Cycle = YX5300_POSITION_CYCLE_NONE;
+#endif
+
+#if (YX5300_USE_LIBRARY)
+  // Responses of initialization must not start the scan
+  Handler->Library.State = YX5300_LIBRARY_EMPTY;
+  Handler->Library.Pending = YX5300_LIBRARY_INIT;
+#endif
+
+  if (Handler->Platform.Init)
+    Handler->Platform.Init(Handler->Platform.UserCtx);
+
+#if (YX5300_USE_FAST_INIT)
+  // The module may ignore the first reset command if it is not ready yet, so
+  // it is sent once more at the time the fixed delay used to expire
+  Result = YX5300_InitCommand(Handler, YX5300_CMD_RESET, 0,
+                              0x3F, 0x3A, YX5300_INIT_TIMEOUT);
+  if (Result == YX5300_TIMEOUT)
+  {
+    YX5300_STATS_INC(Handler, Retries);
+    Result = YX5300_InitCommand(Handler, YX5300_CMD_RESET, 0,
+                                0x3F, 0x3A, YX5300_INIT_TIMEOUT);
+  }
+  if (Result == YX5300_FAIL)
+    return YX5300_FAIL;
+
+  // The module reports an error if there is no memory card
+  Result = YX5300_InitCommand(Handler, YX5300_CMD_SEL_DEV, 2,
+                              0x41, 0x40, YX5300_INIT_TIMEOUT);
+  if (Result == YX5300_OK && Handler->Wait.Received == 0x40)
+    Result = YX5300_FAIL;
+  if (Result != YX5300_OK)
+  {
+#if (YX5300_USE_LIBRARY)
+    // The scan is started when a memory card is inserted
+    Handler->Library.Pending = 0;
+#endif
+    return Result;
+  }
+#else
+  (void)Result;
+  YX5300_WaitFor(Handler, YX5300_INIT_TIMEOUT);
+
+  if (YX5300_TransmitCommand(Handler, YX5300_CMD_RESET,
+                             YX5300_CMD_FEEDBACK, 0, 0) != YX5300_OK)
+    return YX5300_FAIL;
+  YX5300_WaitFor(Handler, YX5300_INIT_TIMEOUT);
+
+  if (YX5300_TransmitCommand(Handler, YX5300_CMD_SEL_DEV,
+                             YX5300_CMD_FEEDBACK, 0, 2) != YX5300_OK)
+    return YX5300_FAIL;
+  YX5300_WaitFor(Handler, YX5300_INIT_TIMEOUT);
+#endif
+
+#if (YX5300_USE_LIBRARY)
+  Handler->Library.Pending = 0;
+  if (Handler->Library.Table != NULL &&
+      YX5300_LibraryStart(Handler) == YX5300_FAIL)
+    return YX5300_FAIL;
+#endif
+
+  return YX5300_OK;
+}
+
+
+/**
+ * @brief  Deinitialize function
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ */
+YX5300_Result_t
+YX5300_DeInit(YX5300_Handler_t *Handler)
+{
+  if (Handler == NULL)
+    return YX5300_INVALID_PARAM;
+
+  if (Handler->Platform.DeInit)
+    Handler->Platform.DeInit(Handler->Platform.UserCtx);
+
+  return YX5300_OK;
+}
+
+
+/**
+ * @brief  Rx callback function
+ * @param  Handler: Pointer to handler
+ * @param  Data: Received data
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_RX_COMPLETE: Frame received successfully and status updated.
+ */
+YX5300_Result_t
+YX5300_Rx(YX5300_Handler_t *Handler, uint8_t Data)
+{
+  return YX5300_RxByte(Handler, Data);
+}
+
+
+/**
+ * @brief  Rx callback function for a block of received data
+ * @note   All bytes are parsed in one call. Each complete frame updates the
+ *         status (and dispatches its event) as soon as it is parsed.
+ * @param  Handler: Pointer to handler
+ * @param  Data: Pointer to received data
+ * @param  Len: Number of received bytes
+ * @param  Frames: Pointer to store the number of complete frames (can be NULL)
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: All bytes parsed and no frame completed.
+ *         - YX5300_FAIL: At least one frame was dropped or failed to parse.
+ *         - YX5300_RX_COMPLETE: At least one frame received successfully and
+ *                               status updated.
+ */
+YX5300_Result_t
+YX5300_RxBuffer(YX5300_Handler_t *Handler,
+                const uint8_t *Data, uint16_t Len, uint16_t *Frames)
+{
+  YX5300_Result_t Result = YX5300_OK;
+  uint16_t Count = 0;
+  uint16_t i = 0;
+
+  for (i = 0; i < Len; i++)
+  {
+    switch (YX5300_RxByte(Handler, Data[i]))
+    {
+    case YX5300_RX_COMPLETE:
+      Count++;
+      if (Result == YX5300_OK)
+        Result = YX5300_RX_COMPLETE;
+      break;
+
+    case YX5300_FAIL:
+      Result = YX5300_FAIL;
+      break;
+
+    default:
+      break;
+    }
+  }
+
+  if (Frames)
+    *Frames = Count;
+
+  return Result;
+}
+
+
+/**
+ * @brief  Process function
+ * @note   This function must be called periodically when YX5300_USE_TX_QUEUE is
+ *         enabled. It sends the queued commands one by one. Each command is sent
+ *         after the ACK of the previous command is received or the ACK timeout
+ *         (YX5300_TX_ACK_TIMEOUT or the value set by YX5300_SetAckTimeout) is
+ *         expired.
+ * @note   If YX5300_USE_TX_RETRY is enabled, a command that gets no ACK or gets a
+ *         transient error is sent again before the next queued command, and the
+ *         ACK timeout is computed from the measured ACK round-trip time.
+ * @note   If YX5300_USE_LIBRARY is enabled, this function must also be called
+ *         periodically during a library scan to send the lost queries again.
+ * @note   If YX5300_USE_TX_QUEUE is disabled, this function does nothing.
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send data.
+ */
+YX5300_Result_t
+YX5300_Process(YX5300_Handler_t *Handler)
+{
+#if (YX5300_USE_TX_QUEUE)
+  YX5300_Result_t Result = YX5300_OK;
+  uint32_t Tick = 0;
+  uint8_t Lane = 1;
+  uint8_t Command = 0;
+  uint8_t Feedback = 0;
+  uint8_t Data1 = 0;
+  uint8_t Data2 = 0;
+#if (YX5300_USE_TX_RETRY)
+  uint16_t Timeout = 0;
+#endif
+#if (YX5300_USE_BATCH)
+  uint8_t Sent = 0;
+#endif
+
+  if (Handler == NULL)
+    return YX5300_INVALID_PARAM;
+
+#if (YX5300_USE_LIBRARY)
+  // A sent query of the library scan is queued
+  YX5300_LibraryProcess(Handler);
+#endif
+
+  Tick = Handler->Platform.GetTick(Handler->Platform.UserCtx);
+
+  YX5300_Lock(Handler);
+
+#if (YX5300_USE_FADE)
+  YX5300_FadeStep(Handler, Tick);
+#endif
+
+  if (Handler->Tx.WaitAck &&
+      (uint32_t)(Tick - Handler->Tx.SendTick) < Handler->Tx.Timeout)
+  {
+    YX5300_Unlock(Handler);
+    return YX5300_OK;
+  }
+  if (Handler->Tx.WaitAck == 1)
+  {
+    YX5300_STATS_INC(Handler, AckTimeouts);
+#if (YX5300_USE_TX_RETRY)
+    if (Handler->Tx.Retries < YX5300_TX_RETRY_COUNT)
+      Handler->Tx.Retry = 1;
+#endif
+  }
+  Handler->Tx.WaitAck = 0;
+
+#if (YX5300_TX_MIN_GAP > 0)
+  if ((uint32_t)(Tick - Handler->Tx.SendTick) < YX5300_TX_MIN_GAP)
+  {
+    YX5300_Unlock(Handler);
+    return YX5300_OK;
+  }
+#endif
+
+#if (YX5300_USE_TX_RETRY)
+#if (YX5300_USE_TX_PRIORITY)
+  // Urgent commands do not wait for the retry of a normal command. It goes
+  // back to the front of normal lane, so it is sent again after them.
+  if (Handler->Tx.Retry && Handler->Tx.Last.Lane == 1 &&
+      Handler->Tx.UrgentCount != 0 && Handler->Tx.Count < YX5300_TX_QUEUE_SIZE)
+  {
+    Handler->Tx.Tail = (Handler->Tx.Tail + YX5300_TX_QUEUE_SIZE - 1) %
+                       YX5300_TX_QUEUE_SIZE;
+    Handler->Tx.Queue[Handler->Tx.Tail].Command = Handler->Tx.Last.Command;
+    Handler->Tx.Queue[Handler->Tx.Tail].Feedback = Handler->Tx.Last.Feedback;
+    Handler->Tx.Queue[Handler->Tx.Tail].Data1 = Handler->Tx.Last.Data1;
+    Handler->Tx.Queue[Handler->Tx.Tail].Data2 = Handler->Tx.Last.Data2;
+    Handler->Tx.Count++;
+    Handler->Tx.Retry = 0;
+    YX5300_STATS_INC(Handler, Retries);
+  }
+#endif
+  if (Handler->Tx.Retry)
+  {
+    // Send the last command again and double its timeout
+    Command = Handler->Tx.Last.Command;
+    Feedback = Handler->Tx.Last.Feedback;
+    Data1 = Handler->Tx.Last.Data1;
+    Data2 = Handler->Tx.Last.Data2;
+
+    Timeout = Handler->Tx.AckTimeout ?
+              Handler->Tx.AckTimeout : YX5300_TX_ACK_TIMEOUT;
+    if (Handler->Tx.Timeout < (Timeout >> 1))
+      Timeout = Handler->Tx.Timeout << 1;
+
+    Handler->Tx.Retry = 0;
+    Handler->Tx.Retries++;
+    Handler->Tx.Timeout = Timeout;
+    Handler->Tx.WaitAck = 1;
+    Handler->Tx.SendTick = Tick;
+    YX5300_STATS_INC(Handler, Retries);
+
+    YX5300_Unlock(Handler);
+
+    if (YX5300_TransmitCommand(Handler, Command, Feedback, Data1, Data2) != YX5300_OK)
+    {
+      YX5300_Lock(Handler);
+      Handler->Tx.WaitAck = 0;
+      Handler->Tx.Retry = 1;
+      Handler->Tx.Retries--;
+      YX5300_Unlock(Handler);
+      return YX5300_FAIL;
+    }
+
+    return YX5300_OK;
+  }
+#endif
+
+  if (YX5300_TxPending(Handler) == 0)
+  {
+    YX5300_Unlock(Handler);
+    return YX5300_OK;
+  }
+
+#if (YX5300_USE_TX_PRIORITY)
+#if (YX5300_USE_BATCH)
+  // The rest of a partly sent batch goes before the urgent commands
+  if (Handler->Tx.UrgentCount != 0 && Handler->Batch.Sent == 0)
+#else
+  if (Handler->Tx.UrgentCount != 0)
+#endif
+  {
+    Command = Handler->Tx.Urgent[Handler->Tx.UrgentTail].Command;
+    Feedback = Handler->Tx.Urgent[Handler->Tx.UrgentTail].Feedback;
+    Data1 = Handler->Tx.Urgent[Handler->Tx.UrgentTail].Data1;
+    Data2 = Handler->Tx.Urgent[Handler->Tx.UrgentTail].Data2;
+    Lane = 2;
+  }
+  else
+  {
+    Command = Handler->Tx.Queue[Handler->Tx.Tail].Command;
+    Feedback = Handler->Tx.Queue[Handler->Tx.Tail].Feedback;
+    Data1 = Handler->Tx.Queue[Handler->Tx.Tail].Data1;
+    Data2 = Handler->Tx.Queue[Handler->Tx.Tail].Data2;
+  }
+#else
+  Command = Handler->Tx.Queue[Handler->Tx.Tail].Command;
+  Feedback = Handler->Tx.Queue[Handler->Tx.Tail].Feedback;
+  Data1 = Handler->Tx.Queue[Handler->Tx.Tail].Data1;
+  Data2 = Handler->Tx.Queue[Handler->Tx.Tail].Data2;
+#endif
+
+  // There is no ACK for commands without feedback, but the module still needs
+  // a gap before the next command
+  Handler->Tx.Timeout = YX5300_TX_NO_ACK_GAP;
+  Handler->Tx.WaitAck = 2;
+  if (Feedback == YX5300_CMD_FEEDBACK)
+  {
+#if (YX5300_USE_TX_RETRY)
+    Handler->Tx.Timeout = YX5300_TxRto(Handler);
+#else
+    Handler->Tx.Timeout = Handler->Tx.AckTimeout ?
+                          Handler->Tx.AckTimeout : YX5300_TX_ACK_TIMEOUT;
+#endif
+    Handler->Tx.WaitAck = 1;
+  }
+  Handler->Tx.Sending = Lane;
+  Handler->Tx.SendTick = Tick;
+#if (YX5300_USE_TX_RETRY)
+  Handler->Tx.Last.Command = Command;
+  Handler->Tx.Last.Feedback = Feedback;
+  Handler->Tx.Last.Data1 = Data1;
+  Handler->Tx.Last.Data2 = Data2;
+#if (YX5300_USE_TX_PRIORITY)
+  Handler->Tx.Last.Lane = Lane;
+#endif
+  Handler->Tx.Retries = 0;
+#endif
+#if (YX5300_USE_BATCH)
+  if (Command == YX5300_TX_BATCH)
+  {
+    // The module receives the frames one by one with the batch gap
+    Handler->Tx.Timeout += (Handler->Batch.Count - Handler->Batch.Sent - 1) *
+                           (YX5300_BATCH_GAP + YX5300_FRAME_SIZE);
+#if (YX5300_USE_TX_RETRY)
+    // Sending the commands of a batch again may repeat the received ones
+    Handler->Tx.Retries = YX5300_TX_RETRY_COUNT;
+#endif
+  }
+#endif
+
+  YX5300_Unlock(Handler);
+
+  // The command stays in the queue until it is sent. WaitAck prevents sending
+  // it again from another context and Sending prevents replacing it meanwhile.
+#if (YX5300_USE_BATCH)
+  if (Command == YX5300_TX_BATCH)
+    Result = YX5300_TransmitFrames(Handler,
+                                   &Handler->Batch.Buffer[Handler->Batch.Sent *
+                                                          YX5300_FRAME_SIZE],
+                                   Handler->Batch.Count - Handler->Batch.Sent,
+                                   &Sent);
+  else
+    Result = YX5300_TransmitCommand(Handler, Command, Feedback, Data1, Data2);
+#else
+  Result = YX5300_TransmitCommand(Handler, Command, Feedback, Data1, Data2);
+#endif
+  if (Result != YX5300_OK)
+  {
+    YX5300_Lock(Handler);
+    Handler->Tx.WaitAck = 0;
+    Handler->Tx.Sending = 0;
+    YX5300_Unlock(Handler);
+    return YX5300_FAIL;
+  }
+
+#if (YX5300_USE_BATCH)
+  // The gap starts after the frames are sent
+  if (Command == YX5300_TX_BATCH)
+    Tick = Handler->Platform.GetTick(Handler->Platform.UserCtx);
+#endif
+
+  YX5300_Lock(Handler);
+#if (YX5300_USE_BATCH)
+  if (Command == YX5300_TX_BATCH &&
+      Handler->Batch.Sent + Sent < Handler->Batch.Count)
+  {
+    // The rest of the batch is sent after the gap. The sent frames are not
+    // sent again, even if the next part fails.
+    Handler->Batch.Sent += Sent;
+    Handler->Tx.Timeout = YX5300_BATCH_GAP;
+    Handler->Tx.WaitAck = 2;
+    Handler->Tx.SendTick = Tick;
+    Handler->Tx.Sending = 0;
+    YX5300_Unlock(Handler);
+    return YX5300_OK;
+  }
+#endif
+#if (YX5300_USE_TX_PRIORITY)
+  if (Lane == 2)
+  {
+    Handler->Tx.UrgentTail = (Handler->Tx.UrgentTail + 1) % YX5300_TX_URGENT_SIZE;
+    Handler->Tx.UrgentCount--;
+  }
+  else
+  {
+    Handler->Tx.Tail = (Handler->Tx.Tail + 1) % YX5300_TX_QUEUE_SIZE;
+    Handler->Tx.Count--;
+  }
+#else
+  Handler->Tx.Tail = (Handler->Tx.Tail + 1) % YX5300_TX_QUEUE_SIZE;
+  Handler->Tx.Count--;
+#endif
+  Handler->Tx.Sending = 0;
+#if (YX5300_USE_BATCH)
+  if (Command == YX5300_TX_BATCH)
+  {
+    Handler->Batch.Sent = 0;
+    Handler->Batch.State = YX5300_BATCH_IDLE;
+  }
+#endif
+  YX5300_Unlock(Handler);
+#elif (YX5300_USE_LIBRARY)
+  if (Handler == NULL)
+    return YX5300_INVALID_PARAM;
+
+  YX5300_LibraryProcess(Handler);
+#else
+  (void)Handler;
+#endif
+
+  return YX5300_OK;
+}
+
+
+/**
+ * @brief  Update status in handler
+ * @note   After calling this function, user should wait for YX5300_RX_COMPLETE of
+ *         YX5300_Rx callback function to be called. Then user can check the
+ *         StatusByte in handler to see the current status.
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_UpdateStatus(YX5300_Handler_t *Handler)
+{
+#if (YX5300_USE_CACHE)
+  if (Handler == NULL)
+    return YX5300_INVALID_PARAM;
+
+  if (YX5300_CacheIsFresh(Handler, YX5300_CMD_QUERY_STATUS))
+    return YX5300_OK;
+#endif
+
+  return YX5300_SendCommand(Handler, YX5300_CMD_QUERY_STATUS, 0, 0);
+}
+
+
+/**
+ * @brief  Update current volume level
+ * @note   After calling this function, user should wait for YX5300_RX_COMPLETE of
+ *         YX5300_Rx callback function to be called. Then user can check the
+ *         Volume in handler to see the current volume level.
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_UpdateVolume(YX5300_Handler_t *Handler)
+{
+#if (YX5300_USE_CACHE)
+  if (Handler == NULL)
+    return YX5300_INVALID_PARAM;
+
+  if (YX5300_CacheIsFresh(Handler, YX5300_CMD_QUERY_VOLUME))
+    return YX5300_OK;
+#endif
+
+  return YX5300_SendCommand(Handler, YX5300_CMD_QUERY_VOLUME, 0, 0);
+}
+
+
+/**
+ * @brief  Update current track number
+ * @note   After calling this function, user should wait for YX5300_RX_COMPLETE of
+ *         YX5300_Rx callback function to be called. Then user can check the
+ *         Track in handler to see the current track number.
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_UpdateTrack(YX5300_Handler_t *Handler)
+{
+#if (YX5300_USE_CACHE)
+  if (Handler == NULL)
+    return YX5300_INVALID_PARAM;
+
+  if (YX5300_CacheIsFresh(Handler, YX5300_CMD_PLAYING_N))
+    return YX5300_OK;
+#endif
+
+  return YX5300_SendCommand(Handler, YX5300_CMD_PLAYING_N, 0, 0);
+}
+
+
+/**
+ * @brief  Query current status and wait for the response
+ * @note   This function returns as soon as the response of module is parsed.
+ *         If Receive function of platform is not linked, user must pass the
+ *         received data to YX5300_Rx or YX5300_RxBuffer from another context
+ *         (e.g. UART interrupt).
+ * @param  Handler: Pointer to handler
+ * @param  Status: Pointer to store the status (0x00: Stop, 0x01: Play, 0x02: Pause)
+ * @param  Timeout: Maximum time to wait for the response in ms
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ *         - YX5300_TIMEOUT: No response received in Timeout.
+ */
+YX5300_Result_t
+YX5300_QueryStatus(YX5300_Handler_t *Handler, uint8_t *Status, uint16_t Timeout)
+{
+  YX5300_Result_t Result = YX5300_OK;
+
+  if (Handler == NULL || Status == NULL)
+    return YX5300_INVALID_PARAM;
+
+  Result = YX5300_Query(Handler, YX5300_CMD_QUERY_STATUS, Timeout);
+  if (Result == YX5300_OK)
+    *Status = Handler->Status.StatusByte;
+
+  return Result;
+}
+
+
+/**
+ * @brief  Query current volume level and wait for the response
+ * @note   This function returns as soon as the response of module is parsed.
+ *         If Receive function of platform is not linked, user must pass the
+ *         received data to YX5300_Rx or YX5300_RxBuffer from another context
+ *         (e.g. UART interrupt).
+ * @param  Handler: Pointer to handler
+ * @param  Volume: Pointer to store the volume level
+ * @param  Timeout: Maximum time to wait for the response in ms
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ *         - YX5300_TIMEOUT: No response received in Timeout.
+ */
+YX5300_Result_t
+YX5300_QueryVolume(YX5300_Handler_t *Handler, uint8_t *Volume, uint16_t Timeout)
+{
+  YX5300_Result_t Result = YX5300_OK;
+
+  if (Handler == NULL || Volume == NULL)
+    return YX5300_INVALID_PARAM;
+
+  Result = YX5300_Query(Handler, YX5300_CMD_QUERY_VOLUME, Timeout);
+  if (Result == YX5300_OK)
+    *Volume = Handler->Status.Volume;
+
+  return Result;
+}
+
+
+/**
+ * @brief  Query current track number and wait for the response
+ * @note   This function returns as soon as the response of module is parsed.
+ *         If Receive function of platform is not linked, user must pass the
+ *         received data to YX5300_Rx or YX5300_RxBuffer from another context
+ *         (e.g. UART interrupt).
+ * @param  Handler: Pointer to handler
+ * @param  Track: Pointer to store the track number
+ * @param  Timeout: Maximum time to wait for the response in ms
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ *         - YX5300_TIMEOUT: No response received in Timeout.
+ */
+YX5300_Result_t
+YX5300_QueryTrack(YX5300_Handler_t *Handler, uint16_t *Track, uint16_t Timeout)
+{
+  YX5300_Result_t Result = YX5300_OK;
+
+  if (Handler == NULL || Track == NULL)
+    return YX5300_INVALID_PARAM;
+
+  Result = YX5300_Query(Handler, YX5300_CMD_PLAYING_N, Timeout);
+  if (Result == YX5300_OK)
+    *Track = Handler->Status.Track;
+
+  return Result;
+}
+
+
+/**
+ * @brief  Get a consistent copy of status
+ * @note   This function does not take the lock at first. It can be called from
+ *         another context while the status is being updated by YX5300_Rx. It
+ *         retries the copy if the status is updated meanwhile, at most
+ *         YX5300_SNAPSHOT_RETRIES times. Then it copies the status under the lock.
+ * @param  Handler: Pointer to handler
+ * @param  Status: Pointer to store the copy of status
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Status was being updated during all retries and Lock
+ *                        is not linked.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_GetStatusSnapshot(YX5300_Handler_t *Handler, YX5300_Status_t *Status)
+{
+  uint32_t Seq = 0;
+  uint8_t i = 0;
+
+  if (Handler == NULL || Status == NULL)
+    return YX5300_INVALID_PARAM;
+
+  for (i = 0; i < YX5300_SNAPSHOT_RETRIES; i++)
+  {
+    Seq = Handler->StatusSeq;
+    YX5300_MEMORY_BARRIER();
+    *Status = Handler->Status;
+    YX5300_MEMORY_BARRIER();
+    if (!(Seq & 1) && Seq == Handler->StatusSeq)
+      return YX5300_OK;
+  }
+
+  // The status is written only while the lock is held
+  if (Handler->Platform.Lock == NULL)
+    return YX5300_FAIL;
+
+  YX5300_Lock(Handler);
+  *Status = Handler->Status;
+  YX5300_Unlock(Handler);
+
+  return YX5300_OK;
+}
+
+
+#if (YX5300_USE_STATS)
+/**
+ * @brief  Get a copy of link statistics
+ * @param  Handler: Pointer to handler
+ * @param  Stats: Pointer to store the statistics
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_GetStats(YX5300_Handler_t *Handler, YX5300_Stats_t *Stats)
+{
+  if (Handler == NULL || Stats == NULL)
+    return YX5300_INVALID_PARAM;
+
+  YX5300_Lock(Handler);
+  *Stats = Handler->Stats.Counters;
+  YX5300_Unlock(Handler);
+
+  Stats->AckLatencyAvg = 0;
+  if (Stats->AckCount)
+    Stats->AckLatencyAvg = (uint16_t)(Stats->AckLatencySum / Stats->AckCount);
+
+  return YX5300_OK;
+}
+
+
+/**
+ * @brief  Reset all link statistics to zero
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_ResetStats(YX5300_Handler_t *Handler)
+{
+  YX5300_Stats_t Zero = {0};
+
+  if (Handler == NULL)
+    return YX5300_INVALID_PARAM;
+
+  YX5300_Lock(Handler);
+  Handler->Stats.Counters = Zero;
+  Handler->Stats.WaitAck = 0;
+  YX5300_Unlock(Handler);
+
+  return YX5300_OK;
+}
+#endif
+
+
+#if (YX5300_USE_POSITION)
+/**
+ * @brief  Get the estimated position of the playing track
+ * @note   The module does not report the position, so it is counted locally
+ *         from the ACKs of play, pause, resume and stop commands and the
+ *         completed play response. No frame is sent. The position is only known
+ *         for the commands that are sent with feedback.
+ * @note   The track number of the next/previous track is only known if the
+ *         current track and the total number of tracks are known. Folder/file
+ *         commands are converted to track numbers by the media library index if
+ *         it is ready.
+ * @param  Handler: Pointer to handler
+ * @param  Position: Pointer to store the position
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: GetTick is not linked.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_GetPosition(YX5300_Handler_t *Handler, YX5300_Position_t *Position)
+{
+  uint32_t Tick = 0;
+  uint32_t End = 0;
+
+  if (Handler == NULL || Position == NULL)
+    return YX5300_INVALID_PARAM;
+
+  if (Handler->Platform.GetTick == NULL)
+    return YX5300_FAIL;
+
+  Tick = Handler->Platform.GetTick(Handler->Platform.UserCtx);
+
+  YX5300_Lock(Handler);
+
+  Position->Track = Handler->Position.Track;
+  Position->State = Handler->Position.State;
+  Position->Duration = 0;
+  if (Position->Track != 0 && Position->Track <= Handler->Position.Size)
+    Position->Duration = Handler->Position.Durations[Position->Track - 1] * 1000UL;
+
+  End = (Position->State == 0x02) ? Handler->Position.PauseTick : Tick;
+  Position->Elapsed = (Position->State == 0x00) ?
+                      0 : (uint32_t)(End - Handler->Position.StartTick);
+
+  YX5300_Unlock(Handler);
+
+  if (Position->Duration != 0 && Position->Elapsed > Position->Duration)
+    Position->Elapsed = Position->Duration;
+
+  return YX5300_OK;
+}
+
+
+/**
+ * @brief  Set the table of track lengths
+ * @note   The table is not copied and must stay valid. It is used to fill the
+ *         Duration of YX5300_GetPosition and to limit the Elapsed time.
+ * @param  Handler: Pointer to handler
+ * @param  Durations: Length of each track in seconds (track 1 at index 0). NULL
+ *                    removes the table.
+ * @param  Size: Number of entries in Durations
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_SetTrackDurations(YX5300_Handler_t *Handler,
+                         const uint16_t *Durations, uint16_t Size)
+{
+  if (Handler == NULL)
+    return YX5300_INVALID_PARAM;
+
+  YX5300_Lock(Handler);
+  Handler->Position.Durations = Durations;
+  Handler->Position.Size = (Durations != NULL) ? Size : 0;
+  YX5300_Unlock(Handler);
+
+  return YX5300_OK;
+}
+#endif
+
+
+#if (YX5300_USE_CACHE)
+/**
+ * @brief  Invalidate all cached values
+ * @note   Call this function if the state of module may be changed without
+ *         this driver (e.g. the module is reset by hardware).
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_CacheInvalidate(YX5300_Handler_t *Handler)
+{
+  if (Handler == NULL)
+    return YX5300_INVALID_PARAM;
+
+  YX5300_Lock(Handler);
+  Handler->Cache.Valid = 0;
+  YX5300_Unlock(Handler);
+
+  return YX5300_OK;
+}
+#endif
+
+
+/**
+ * @brief  Play next track
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_PlayNext(YX5300_Handler_t *Handler)
+{
+  return YX5300_SendCommand(Handler, YX5300_CMD_NEXT, 0, 0);
+}
+
+
+/**
+ * @brief  Play previous track
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_PlayPrev(YX5300_Handler_t *Handler)
+{
+  return YX5300_SendCommand(Handler, YX5300_CMD_PREV, 0, 0);
+}
+
+
+/**
+ * @brief  Increase volume one step
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_VolumeUp(YX5300_Handler_t *Handler)
+{
+  return YX5300_SendCommand(Handler, YX5300_CMD_VOL_UP, 0, 0);
+}
+
+
+/**
+ * @brief  Decrease volume one step
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_VolumeDown(YX5300_Handler_t *Handler)
+{
+  return YX5300_SendCommand(Handler, YX5300_CMD_VOL_DOWN, 0, 0);
+}
+
+
+/**
+ * @brief  Set volume level
+ * @note   If YX5300_USE_CACHE is enabled and the module is known to be in the
+ *         requested state, the command is not sent.
+ * @param  Handler: Pointer to handler
+ * @param  Volume: Volume level (0-30)
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_SetVolume(YX5300_Handler_t *Handler, uint8_t Volume)
+{
+  if (Volume > 30)
+    Volume = 30;
+  return YX5300_SendCommand(Handler, YX5300_CMD_VOL_SET, 0, Volume);
+}
+
+
+#if (YX5300_USE_TX_QUEUE && YX5300_USE_FADE)
+/**
+ * @brief  Fade the volume to a level in a period of time
+ * @note   This function only starts the fade and returns. The volume commands
+ *         are sent by YX5300_Process, one after the ACK of the previous
+ *         command, with the volume of the elapsed fraction of Duration. So the
+ *         number of steps depends on the ACK round-trip time and a step that
+ *         would not change the volume is not sent.
+ * @note   The fade starts from the last step of the running fade. Otherwise it
+ *         starts when the queued commands are sent, from the last volume that
+ *         is sent to the module or confirmed by a volume reply. If that volume
+ *         is unknown (e.g. after init or reset, or a volume step from an unknown
+ *         level), the target is sent in one step. Call YX5300_QueryVolume before
+ *         to fade from the current volume. Volume commands of user stop the fade.
+ * @param  Handler: Pointer to handler
+ * @param  Volume: Target volume level (0-30)
+ * @param  Duration: Fade time in ms (0: the next step sets the target)
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_FadeTo(YX5300_Handler_t *Handler, uint8_t Volume, uint16_t Duration)
+{
+  uint32_t Tick = 0;
+  uint8_t Start = 0;
+
+  if (Handler == NULL)
+    return YX5300_INVALID_PARAM;
+
+  if (Volume > 30)
+    Volume = 30;
+
+  Tick = Handler->Platform.GetTick(Handler->Platform.UserCtx);
+
+  YX5300_Lock(Handler);
+
+  // A new fade starts from the last step of the running fade, otherwise from
+  // the volume of the module when the queued commands are sent
+  if (Handler->Fade.Active)
+    Start = Handler->Fade.Volume;
+  else
+    Start = YX5300_FADE_UNKNOWN;
+
+  YX5300_FadeStart(Handler, Tick, Start, Volume, Duration);
+
+  YX5300_Unlock(Handler);
+  return YX5300_OK;
+}
+#endif
+
+
+/**
+ * @brief  Play track by index
+ * @note   If YX5300_USE_CACHE is enabled and the module is known to be in the
+ *         requested state, the command is not sent.
+ * @param  Handler: Pointer to handler
+ * @param  Track: Track number
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_PlayTrack(YX5300_Handler_t *Handler, uint16_t Track)
+{
+  return YX5300_SendCommand(Handler, YX5300_CMD_PLAY_INDEX,
+                            (uint8_t)(Track >> 8), (uint8_t)(Track & 0xFF));
+}
+
+/**
+ * @brief  Play track by folder and file number
+ * @note   If YX5300_USE_CACHE is enabled and the module is known to be in the
+ *         requested state, the command is not sent.
+ * @param  Handler: Pointer to handler
+ * @param  Folder: Folder number
+ * @param  File: File number
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_PlayFolderFile(YX5300_Handler_t *Handler, uint8_t Folder, uint8_t File)
+{
+  return YX5300_SendCommand(Handler, YX5300_CMD_PLAY_FOLD_FILE, Folder, File);
+}
+
+
+/**
+ * @brief  Resume playback
+ * @note   If YX5300_USE_CACHE is enabled and the module is known to be in the
+ *         requested state, the command is not sent.
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_Resume(YX5300_Handler_t *Handler)
+{
+  return YX5300_SendCommand(Handler, YX5300_CMD_PLAY, 0, 0);
+}
+
+
+/**
+ * @brief  Pause playback
+ * @note   If YX5300_USE_CACHE is enabled and the module is known to be in the
+ *         requested state, the command is not sent.
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_Pause(YX5300_Handler_t *Handler)
+{
+  return YX5300_SendCommand(Handler, YX5300_CMD_PAUSE, 0, 0);
+}
+
+
+/**
+ * @brief  Stop playback
+ * @note   If YX5300_USE_CACHE is enabled and the module is known to be in the
+ *         requested state, the command is not sent.
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_Stop(YX5300_Handler_t *Handler)
+{
+  return YX5300_SendCommand(Handler, YX5300_CMD_STOP, 0, 0);
+}
+
+
+/**
+ * @brief  Play track with a volume level in one command
+ * @note   If YX5300_USE_CACHE is enabled and the module is known to be in the
+ *         requested state, the command is not sent.
+ * @param  Handler: Pointer to handler
+ * @param  Track: Track number (1-255)
+ * @param  Volume: Volume level (0-30)
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_PlayWithVolume(YX5300_Handler_t *Handler, uint8_t Track, uint8_t Volume)
+{
+  if (Volume > 30)
+    Volume = 30;
+  return YX5300_SendCommand(Handler, YX5300_CMD_PLAY_WITH_VOL, Volume, Track);
+}
+
+
+/**
+ * @brief  Play all files of a folder repeatedly
+ * @param  Handler: Pointer to handler
+ * @param  Folder: Folder number
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_PlayFolderCycle(YX5300_Handler_t *Handler, uint8_t Folder)
+{
+  return YX5300_SendCommand(Handler, YX5300_CMD_PLAY_CYCLE_FOLD, Folder, 0);
+}
+
+
+/**
+ * @brief  Play a track repeatedly
+ * @param  Handler: Pointer to handler
+ * @param  Track: Track number
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_PlayTrackCycle(YX5300_Handler_t *Handler, uint16_t Track)
+{
+  return YX5300_SendCommand(Handler, YX5300_CMD_SINGLE_CYCLE,
+                            (uint8_t)(Track >> 8), (uint8_t)(Track & 0xFF));
+}
+
+
+/**
+ * @brief  Enable or disable repeating the current track
+ * @param  Handler: Pointer to handler
+ * @param  Enable: 1 to repeat the current track, 0 to stop repeating
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_SetSingleCycle(YX5300_Handler_t *Handler, uint8_t Enable)
+{
+  return YX5300_SendCommand(Handler, YX5300_CMD_SET_SNGL_CYCL, 0, Enable ? 0x00 : 0x01);
+}
+
+
+/**
+ * @brief  Turn the DAC output on or off
+ * @param  Handler: Pointer to handler
+ * @param  Enable: 1 to turn the DAC on, 0 to turn it off
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_SetDAC(YX5300_Handler_t *Handler, uint8_t Enable)
+{
+  return YX5300_SendCommand(Handler, YX5300_CMD_SET_DAC, 0, Enable ? 0x00 : 0x01);
+}
+
+
+/**
+ * @brief  Put the module into sleep mode
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_Sleep(YX5300_Handler_t *Handler)
+{
+  return YX5300_SendCommand(Handler, YX5300_CMD_SLEEP_MODE, 0, 0);
+}
+
+
+/**
+ * @brief  Wake the module up from sleep mode
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_WakeUp(YX5300_Handler_t *Handler)
+{
+  return YX5300_SendCommand(Handler, YX5300_CMD_WAKE_UP, 0, 0);
+}
+
+
+#if (YX5300_USE_PLAYLIST)
+/**
+ * @brief  Remove all items from the playlist and stop the playlist engine
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_PlaylistClear(YX5300_Handler_t *Handler)
+{
+  if (Handler == NULL)
+    return YX5300_INVALID_PARAM;
+
+  YX5300_Lock(Handler);
+  Handler->Playlist.Active = 0;
+  Handler->Playlist.Count = 0;
+  Handler->Playlist.Index = 0;
+  YX5300_Unlock(Handler);
+
+  return YX5300_OK;
+}
+
+
+/**
+ * @brief  Add an item to the end of the playlist
+ * @param  Handler: Pointer to handler
+ * @param  Folder: Folder number (if 0, File is the track number)
+ * @param  File: File number in folder or track number (if 0 and Folder is not
+ *               0, all files of the folder are played repeatedly until
+ *               YX5300_PlaylistNext is called)
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Playlist is full.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_PlaylistAdd(YX5300_Handler_t *Handler, uint8_t Folder, uint16_t File)
+{
+  return YX5300_PlaylistAddWithVolume(Handler, Folder, File, 0);
+}
+
+
+/**
+ * @brief  Add an item with its own volume level to the end of the playlist
+ * @note   The volume is set right before playing the item. For a track number
+ *         up to 255 the track and volume are sent in one command.
+ * @note   If YX5300_PLAYLIST_FADE_TIME is not 0 (and YX5300_USE_FADE is
+ *         enabled), the item is started silent and faded in to its volume.
+ * @param  Handler: Pointer to handler
+ * @param  Folder: Folder number (if 0, File is the track number)
+ * @param  File: File number in folder or track number (if 0 and Folder is not
+ *               0, all files of the folder are played repeatedly until
+ *               YX5300_PlaylistNext is called)
+ * @param  Volume: Volume level (1-30, 0 means keep the current volume)
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Playlist is full.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_PlaylistAddWithVolume(YX5300_Handler_t *Handler,
+                             uint8_t Folder, uint16_t File, uint8_t Volume)
+{
+  if (Handler == NULL || (Folder != 0 && File > 0xFF) ||
+      (Folder == 0 && File == 0))
+    return YX5300_INVALID_PARAM;
+
+  if (Volume > 30)
+    Volume = 30;
+
+  YX5300_Lock(Handler);
+
+  if (Handler->Playlist.Count >= YX5300_PLAYLIST_SIZE)
+  {
+    YX5300_Unlock(Handler);
+    return YX5300_FAIL;
+  }
+
+  Handler->Playlist.Items[Handler->Playlist.Count].Folder = Folder;
+  Handler->Playlist.Items[Handler->Playlist.Count].Volume = Volume;
+  Handler->Playlist.Items[Handler->Playlist.Count].File = File;
+  Handler->Playlist.Count++;
+
+  YX5300_Unlock(Handler);
+
+  return YX5300_OK;
+}
+
+
+/**
+ * @brief  Set play mode of the playlist
+ * @param  Handler: Pointer to handler
+ * @param  Mode: Play mode
+ *         - YX5300_PLAYMODE_SEQUENTIAL: Play items in order and stop at the end.
+ *         - YX5300_PLAYMODE_REPEAT: Play items in order and repeat from first.
+ *         - YX5300_PLAYMODE_SHUFFLE: Play random items endlessly.
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_PlaylistSetMode(YX5300_Handler_t *Handler, YX5300_PlayMode_t Mode)
+{
+  if (Handler == NULL || Mode > YX5300_PLAYMODE_SHUFFLE)
+    return YX5300_INVALID_PARAM;
+
+  YX5300_Lock(Handler);
+  Handler->Playlist.Mode = Mode;
+  YX5300_Unlock(Handler);
+
+  return YX5300_OK;
+}
+
+
+/**
+ * @brief  Start playing the playlist from an item
+ * @note   The next item is requested as soon as the "completed play" (0x3D)
+ *         response of module is parsed. So the requests are sent from the
+ *         context that calls YX5300_Rx or YX5300_RxBuffer (if YX5300_USE_TX_QUEUE
+ *         is disabled).
+ * @param  Handler: Pointer to handler
+ * @param  Index: Index of the first item to play
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send data.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_PlaylistPlay(YX5300_Handler_t *Handler, uint8_t Index)
+{
+  YX5300_Result_t Result = YX5300_OK;
+  uint32_t Tick = 0;
+  uint8_t Folder = 0;
+  uint8_t Volume = 0;
+  uint16_t File = 0;
+
+  if (Handler == NULL)
+    return YX5300_INVALID_PARAM;
+
+  if (Handler->Platform.GetTick)
+    Tick = Handler->Platform.GetTick(Handler->Platform.UserCtx);
+
+  YX5300_Lock(Handler);
+
+  if (Index >= Handler->Playlist.Count)
+  {
+    YX5300_Unlock(Handler);
+    return YX5300_INVALID_PARAM;
+  }
+
+  if (Handler->Playlist.Seed == 0)
+    Handler->Playlist.Seed = (Tick != 0) ? Tick : 0x5EED5EED;
+
+  Handler->Playlist.Active = 1;
+  Handler->Playlist.Index = Index;
+  Handler->Playlist.Pending = 0;
+  YX5300_PlaylistGetItem(Handler, &Folder, &File, &Volume);
+
+  YX5300_Unlock(Handler);
+
+  Result = YX5300_PlaylistPlayItem(Handler, Folder, File, Volume);
+  if (Result != YX5300_OK)
+  {
+    YX5300_Lock(Handler);
+    Handler->Playlist.Active = 0;
+    YX5300_Unlock(Handler);
+  }
+
+  return Result;
+}
+
+
+/**
+ * @brief  Skip to the next item of the playlist
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send data or playlist is not active.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_PlaylistNext(YX5300_Handler_t *Handler)
+{
+  uint8_t Play = 0;
+  uint8_t Folder = 0;
+  uint8_t Volume = 0;
+  uint16_t File = 0;
+
+  if (Handler == NULL)
+    return YX5300_INVALID_PARAM;
+
+  YX5300_Lock(Handler);
+
+  if (!Handler->Playlist.Active)
+  {
+    YX5300_Unlock(Handler);
+    return YX5300_FAIL;
+  }
+
+  Play = YX5300_PlaylistAdvance(Handler, &Folder, &File, &Volume);
+
+  YX5300_Unlock(Handler);
+
+  if (!Play)
+    return YX5300_OK;
+
+  return YX5300_PlaylistPlayItem(Handler, Folder, File, Volume);
+}
+
+
+/**
+ * @brief  Stop the playlist engine and playback
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send data.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_PlaylistStop(YX5300_Handler_t *Handler)
+{
+  if (Handler == NULL)
+    return YX5300_INVALID_PARAM;
+
+  YX5300_Lock(Handler);
+  Handler->Playlist.Active = 0;
+  YX5300_Unlock(Handler);
+
+  return YX5300_Stop(Handler);
+}
+#endif
+
+
+#if (YX5300_USE_LIBRARY)
+/**
+ * @brief  Set the buffer of media library index
+ * @note   This function should be called before YX5300_Init, so the index is
+ *         built right after initialization.
+ * @param  Handler: Pointer to handler
+ * @param  Table: Buffer to store the number of files of each folder
+ * @param  Size: Number of entries in Table (maximum number of folders)
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_LibrarySetBuffer(YX5300_Handler_t *Handler, uint8_t *Table, uint8_t Size)
+{
+  if (Handler == NULL || Table == NULL || Size == 0)
+    return YX5300_INVALID_PARAM;
+
+  Handler->Library.Table = Table;
+  Handler->Library.Size = Size;
+  Handler->Library.Folders = 0;
+  Handler->Library.Total = 0;
+  Handler->Library.Pending = 0;
+  Handler->Library.State = YX5300_LIBRARY_EMPTY;
+
+  return YX5300_OK;
+}
+
+
+/**
+ * @brief  Start building the media library index
+ * @note   The folders are queried one by one as soon as the response of the
+ *         previous query is parsed. The index is ready when Library.State of
+ *         handler is YX5300_LIBRARY_READY.
+ * @note   A query with no reply is sent again by YX5300_Process after
+ *         YX5300_LIBRARY_TIMEOUT ms (at most YX5300_LIBRARY_RETRIES times), then
+ *         the scan is stopped and Library.State becomes YX5300_LIBRARY_EMPTY.
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send data or buffer is not set.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_LibraryScan(YX5300_Handler_t *Handler)
+{
+  if (Handler == NULL)
+    return YX5300_INVALID_PARAM;
 
+  if (Handler->Library.Table == NULL)
+    return YX5300_FAIL;
 
+  return YX5300_LibraryStart(Handler);
+}
 
-/**
- ==================================================================================
-                            ##### Public Functions #####                           
- ==================================================================================
- */
 
 /**
- * @brief  Initializer function
- * @note   This function must be called after initializing platform dependent
- *         layer and before using other functions.
+ * @brief  Find folder and file number of a track locally
+ * @note   Tracks are assumed to be numbered folder by folder (files of folder 01
+ *         first, then folder 02, ...), which is the case when the folders are
+ *         copied to the memory card in order.
  * @param  Handler: Pointer to handler
+ * @param  Track: Track number (1 is the first file of the first folder)
+ * @param  Folder: Pointer to store the folder number
+ * @param  File: Pointer to store the file number
  * @retval YX5300_Result_t
  *         - YX5300_OK: Operation was successful.
- *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_FAIL: Index is not ready or track is not found.
  *         - YX5300_INVALID_PARAM: Invalid parameter.
  */
 YX5300_Result_t
-YX5300_Init(YX5300_Handler_t *Handler)
+YX5300_LibraryGetTrack(YX5300_Handler_t *Handler, uint16_t Track,
+                       uint8_t *Folder, uint8_t *File)
 {
-  if (Handler == NULL)
-    return YX5300_INVALID_PARAM;
+  uint8_t i = 0;
 
-  if (Handler->Platform.Delay == NULL ||
-      Handler->Platform.Send == NULL)
+  if (Handler == NULL || Folder == NULL || File == NULL || Track == 0)
     return YX5300_INVALID_PARAM;
 
-  if (Handler->Platform.Init)
-    Handler->Platform.Init();
-  Handler->Platform.Delay(500);
-
-  if (YX5300_SendCommand(Handler, YX5300_CMD_RESET, 0, 0) != YX5300_OK)
+  if (Handler->Library.State != YX5300_LIBRARY_READY)
     return YX5300_FAIL;
-  Handler->Platform.Delay(500);
 
-  if (YX5300_SendCommand(Handler, YX5300_CMD_SEL_DEV, 0, 2) != YX5300_OK)
-    return YX5300_FAIL;
-  Handler->Platform.Delay(500);
+  for (i = 0; i < Handler->Library.Folders; i++)
+  {
+    if (Track <= Handler->Library.Table[i])
+    {
+      *Folder = i + 1;
+      *File = (uint8_t)Track;
+      return YX5300_OK;
+    }
+    Track -= Handler->Library.Table[i];
+  }
 
-  return YX5300_OK;
+  return YX5300_FAIL;
 }
 
 
 /**
- * @brief  Deinitialize function
+ * @brief  Write the media library index into a buffer
+ * @note   The snapshot contains the total number of tracks, so a loaded
+ *         snapshot is only used for the same memory card content.
  * @param  Handler: Pointer to handler
+ * @param  Buffer: Buffer to store the snapshot
+ * @param  Size: Size of Buffer (YX5300_LIBRARY_SNAPSHOT_SIZE(Library.Size) is
+ *               enough for any index)
+ * @param  Len: Pointer to store the length of snapshot
  * @retval YX5300_Result_t
  *         - YX5300_OK: Operation was successful.
- *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_FAIL: Index is not ready or Buffer is too small.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
  */
 YX5300_Result_t
-YX5300_DeInit(YX5300_Handler_t *Handler)
+YX5300_LibrarySave(YX5300_Handler_t *Handler,
+                   uint8_t *Buffer, uint16_t Size, uint16_t *Len)
 {
-  if (Handler == NULL)
-    return YX5300_INVALID_PARAM;
-
-  if (Handler->Platform.DeInit)
-    Handler->Platform.DeInit();
+  uint8_t Folders = 0;
+  uint8_t Sum = 0;
+  uint16_t i = 0;
 
-  return YX5300_OK;
-}
+  if (Handler == NULL || Buffer == NULL || Len == NULL)
+    return YX5300_INVALID_PARAM;
 
+  Folders = Handler->Library.Folders;
+  if (Handler->Library.State != YX5300_LIBRARY_READY ||
+      Size < YX5300_LIBRARY_SNAPSHOT_SIZE(Folders))
+    return YX5300_FAIL;
 
-YX5300_Result_t
-YX5300_Rx(YX5300_Handler_t *Handler, uint8_t Data)
-{
-  if (Handler->Rx.BufferIndex >= YX5300_RESPONSE_SIZE)
-  {
-    Handler->Rx.BufferIndex = 0;
-  }
-  Handler->Rx.Buffer[Handler->Rx.BufferIndex] = Data;
+  // Snapshot Structure  MAGIC TOTH TOTL CNT FILES[CNT] CHK
+  Buffer[0] = YX5300_LIBRARY_MAGIC;
+  Buffer[1] = (uint8_t)(Handler->Library.Total >> 8);
+  Buffer[2] = (uint8_t)(Handler->Library.Total & 0xFF);
+  Buffer[3] = Folders;
+  for (i = 0; i < Folders; i++)
+    Buffer[4 + i] = Handler->Library.Table[i];
 
-  if (Handler->Rx.BufferIndex == 0)
-  {
-    if (Data == YX5300_CMD_START_BYTE)
-    {
-      Handler->Rx.BufferIndex++;
-    }
-  }
-  else
-  {
-    Handler->Rx.BufferIndex++;
-    if (Data == YX5300_CMD_END_BYTE)
-    {
-      Handler->Rx.BufferIndex = 0;
-      if (YX5300_ParseResponse(Handler) != YX5300_OK)
-        return YX5300_FAIL;
-      return YX5300_RX_COMPLETE;
-    }
-  }
+  for (i = 0; i < 4 + Folders; i++)
+    Sum += Buffer[i];
+  Buffer[4 + Folders] = (uint8_t)(0 - Sum);
 
+  *Len = YX5300_LIBRARY_SNAPSHOT_SIZE(Folders);
   return YX5300_OK;
 }
 
 
 /**
- * @brief  Update status in handler
- * @note   After calling this function, user should wait for YX5300_RX_COMPLETE of
- *         YX5300_Rx callback function to be called. Then user can check the
- *         StatusByte in handler to see the current status.
+ * @brief  Read the media library index from a snapshot
+ * @note   This function should be called before YX5300_Init (or before
+ *         YX5300_LibraryScan). Then the scan only queries the total number of
+ *         tracks, and if it matches the snapshot, the index is ready without
+ *         querying the folders.
  * @param  Handler: Pointer to handler
+ * @param  Buffer: Snapshot written by YX5300_LibrarySave
+ * @param  Len: Length of snapshot
  * @retval YX5300_Result_t
  *         - YX5300_OK: Operation was successful.
- *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_FAIL: Snapshot is not valid or does not fit the buffer.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
  */
 YX5300_Result_t
-YX5300_UpdateStatus(YX5300_Handler_t *Handler)
+YX5300_LibraryLoad(YX5300_Handler_t *Handler, const uint8_t *Buffer, uint16_t Len)
 {
-  return YX5300_SendCommand(Handler, YX5300_CMD_QUERY_STATUS, 0, 0);
+  uint8_t Folders = 0;
+  uint8_t Sum = 0;
+  uint16_t i = 0;
+
+  if (Handler == NULL || Buffer == NULL)
+    return YX5300_INVALID_PARAM;
+
+  if (Handler->Library.Table == NULL ||
+      Len < YX5300_LIBRARY_SNAPSHOT_SIZE(0) ||
+      Buffer[0] != YX5300_LIBRARY_MAGIC)
+    return YX5300_FAIL;
+
+  Folders = Buffer[3];
+  if (Folders > Handler->Library.Size ||
+      Len < YX5300_LIBRARY_SNAPSHOT_SIZE(Folders))
+    return YX5300_FAIL;
+
+  for (i = 0; i < YX5300_LIBRARY_SNAPSHOT_SIZE(Folders); i++)
+    Sum += Buffer[i];
+  if (Sum != 0)
+    return YX5300_FAIL;
+
+  for (i = 0; i < Folders; i++)
+    Handler->Library.Table[i] = Buffer[4 + i];
+  Handler->Library.Folders = Folders;
+  Handler->Library.Total = (Buffer[1] << 8) | Buffer[2];
+
+  // The snapshot is used after the total tracks of module is checked
+  if (Handler->Library.State == YX5300_LIBRARY_READY)
+    Handler->Library.State = YX5300_LIBRARY_EMPTY;
+
+  return YX5300_OK;
 }
+#endif
 
 
 /**
- * @brief  Update current volume level
- * @note   After calling this function, user should wait for YX5300_RX_COMPLETE of
- *         YX5300_Rx callback function to be called. Then user can check the
- *         Volume in handler to see the current volume level.
+ * @brief  Set default feedback mode of commands
+ * @note   If feedback is enabled, module sends an ACK frame for each command.
  * @param  Handler: Pointer to handler
+ * @param  Feedback: Feedback mode
+ *         - YX5300_FEEDBACK_DEFAULT: Same as YX5300_FEEDBACK_ENABLE
+ *         - YX5300_FEEDBACK_ENABLE: Module sends ACK for commands.
+ *         - YX5300_FEEDBACK_DISABLE: Module does not send ACK for commands.
  * @retval YX5300_Result_t
  *         - YX5300_OK: Operation was successful.
- *         - YX5300_FAIL: Failed to send or receive data.
  *         - YX5300_INVALID_PARAM: Invalid parameter.
  */
 YX5300_Result_t
-YX5300_UpdateVolume(YX5300_Handler_t *Handler)
+YX5300_SetFeedback(YX5300_Handler_t *Handler, YX5300_Feedback_t Feedback)
 {
-  return YX5300_SendCommand(Handler, YX5300_CMD_QUERY_VOLUME, 0, 0);
+  if (Handler == NULL || Feedback > YX5300_FEEDBACK_DISABLE)
+    return YX5300_INVALID_PARAM;
+
+  Handler->Feedback.Default = Feedback;
+
+  return YX5300_OK;
 }
 
 
 /**
- * @brief  Update current track number
- * @note   After calling this function, user should wait for YX5300_RX_COMPLETE of
- *         YX5300_Rx callback function to be called. Then user can check the
- *         Track in handler to see the current track number.
+ * @brief  Override feedback mode of the next command
+ * @note   The override is applied to the next command only. Then default
+ *         feedback mode of handler is used again.
  * @param  Handler: Pointer to handler
+ * @param  Feedback: Feedback mode
+ *         - YX5300_FEEDBACK_DEFAULT: Use default feedback mode of handler.
+ *         - YX5300_FEEDBACK_ENABLE: Module sends ACK for next command.
+ *         - YX5300_FEEDBACK_DISABLE: Module does not send ACK for next command.
  * @retval YX5300_Result_t
  *         - YX5300_OK: Operation was successful.
- *         - YX5300_FAIL: Failed to send or receive data.
  *         - YX5300_INVALID_PARAM: Invalid parameter.
  */
 YX5300_Result_t
-YX5300_UpdateTrack(YX5300_Handler_t *Handler)
+YX5300_SetNextFeedback(YX5300_Handler_t *Handler, YX5300_Feedback_t Feedback)
 {
-  return YX5300_SendCommand(Handler, YX5300_CMD_PLAYING_N, 0, 0);
+  if (Handler == NULL || Feedback > YX5300_FEEDBACK_DISABLE)
+    return YX5300_INVALID_PARAM;
+
+  Handler->Feedback.Next = Feedback;
+
+  return YX5300_OK;
 }
 
 
+#if (YX5300_USE_EVENTS)
 /**
- * @brief  Play next track
+ * @brief  Set event callback function
+ * @note   The callback is called from the context that calls YX5300_Rx or
+ *         YX5300_RxBuffer, right after a response frame is parsed.
  * @param  Handler: Pointer to handler
+ * @param  Callback: Pointer to callback function (NULL to disable events)
  * @retval YX5300_Result_t
  *         - YX5300_OK: Operation was successful.
- *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
  */
 YX5300_Result_t
-YX5300_PlayNext(YX5300_Handler_t *Handler)
+YX5300_SetEventCallback(YX5300_Handler_t *Handler,
+                        YX5300_EventCallback_t Callback)
 {
-  return YX5300_SendCommand(Handler, YX5300_CMD_NEXT, 0, 0);
+  if (Handler == NULL)
+    return YX5300_INVALID_PARAM;
+
+  Handler->EventCallback = Callback;
+
+  return YX5300_OK;
 }
+#endif
 
 
+#if (YX5300_USE_TX_QUEUE)
 /**
- * @brief  Play previous track
+ * @brief  Set ACK timeout of queued commands for this handler
  * @param  Handler: Pointer to handler
+ * @note   If YX5300_USE_TX_RETRY is enabled, this is the upper bound of the
+ *         adaptive ACK timeout.
+ * @param  Timeout: ACK timeout in ms (0: YX5300_TX_ACK_TIMEOUT)
  * @retval YX5300_Result_t
  *         - YX5300_OK: Operation was successful.
- *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
  */
 YX5300_Result_t
-YX5300_PlayPrev(YX5300_Handler_t *Handler)
+YX5300_SetAckTimeout(YX5300_Handler_t *Handler, uint16_t Timeout)
 {
-  return YX5300_SendCommand(Handler, YX5300_CMD_PREV, 0, 0);
+  if (Handler == NULL)
+    return YX5300_INVALID_PARAM;
+
+  Handler->Tx.AckTimeout = Timeout;
+
+  return YX5300_OK;
 }
+#endif
 
 
+#if (YX5300_USE_TX_QUEUE && YX5300_USE_TX_PRIORITY)
 /**
- * @brief  Increase volume one step
+ * @brief  Put the next command into the urgent lane of Tx queue
+ * @note   Urgent commands are sent before the commands of the normal lane, right
+ *         after the command that is being sent gets its ACK or timeout.
+ *         YX5300_Stop and YX5300_Pause are always urgent.
  * @param  Handler: Pointer to handler
  * @retval YX5300_Result_t
  *         - YX5300_OK: Operation was successful.
- *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
  */
 YX5300_Result_t
-YX5300_VolumeUp(YX5300_Handler_t *Handler)
+YX5300_SetNextUrgent(YX5300_Handler_t *Handler)
 {
-  return YX5300_SendCommand(Handler, YX5300_CMD_VOL_UP, 0, 0);
+  if (Handler == NULL)
+    return YX5300_INVALID_PARAM;
+
+  YX5300_Lock(Handler);
+  Handler->Tx.NextUrgent = 1;
+  YX5300_Unlock(Handler);
+
+  return YX5300_OK;
 }
+#endif
 
 
+#if (YX5300_USE_BATCH)
 /**
- * @brief  Decrease volume one step
+ * @brief  Start recording a batch of commands
+ * @note   Media control commands that are called after this function are not
+ *         sent. They are encoded into the batch buffer until YX5300_EndBatch is
+ *         called. Status update and query functions must not be called meanwhile.
  * @param  Handler: Pointer to handler
  * @retval YX5300_Result_t
  *         - YX5300_OK: Operation was successful.
- *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_FAIL: Another batch is being recorded or is not sent yet.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
  */
 YX5300_Result_t
-YX5300_VolumeDown(YX5300_Handler_t *Handler)
+YX5300_BeginBatch(YX5300_Handler_t *Handler)
 {
-  return YX5300_SendCommand(Handler, YX5300_CMD_VOL_DOWN, 0, 0);
+  if (Handler == NULL)
+    return YX5300_INVALID_PARAM;
+
+  YX5300_Lock(Handler);
+
+  if (Handler->Batch.State != YX5300_BATCH_IDLE)
+  {
+    YX5300_Unlock(Handler);
+    return YX5300_FAIL;
+  }
+
+  Handler->Batch.Count = 0;
+  Handler->Batch.Sent = 0;
+  Handler->Batch.State = YX5300_BATCH_RECORDING;
+
+  YX5300_Unlock(Handler);
+  return YX5300_OK;
 }
 
 
 /**
- * @brief  Set volume level
+ * @brief  Send the recorded batch of commands
+ * @note   All frames are given to the platform in one Send call. Only the last
+ *         command is sent with feedback (if its feedback mode is enabled), so one
+ *         ACK confirms the whole batch.
+ * @note   If YX5300_USE_TX_QUEUE is enabled, the batch is queued as one entry and
+ *         sent by YX5300_Process. If the queue is full, the batch stays recorded
+ *         and this function can be called again later. If the platform layer
+ *         sends only a part of the batch, YX5300_Process sends the rest after
+ *         YX5300_BATCH_GAP and no other command is sent in between.
+ * @note   If YX5300_USE_TX_QUEUE is disabled and sending fails after some frames,
+ *         the rest of the batch is dropped, so no command is sent twice.
  * @param  Handler: Pointer to handler
- * @param  Volume: Volume level (0-30)
  * @retval YX5300_Result_t
  *         - YX5300_OK: Operation was successful.
- *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_FAIL: No batch is recorded or failed to send data.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
  */
 YX5300_Result_t
-YX5300_SetVolume(YX5300_Handler_t *Handler, uint8_t Volume)
+YX5300_EndBatch(YX5300_Handler_t *Handler)
 {
-  if (Volume > 30)
-    Volume = 30;
-  return YX5300_SendCommand(Handler, YX5300_CMD_VOL_SET, 0, Volume);
+  uint8_t *Last = NULL;
+#if (!YX5300_USE_TX_QUEUE)
+  YX5300_Result_t Result = YX5300_OK;
+  uint8_t Sent = 0;
+#endif
+
+  if (Handler == NULL)
+    return YX5300_INVALID_PARAM;
+
+  YX5300_Lock(Handler);
+
+  if (Handler->Batch.State != YX5300_BATCH_RECORDING)
+  {
+    YX5300_Unlock(Handler);
+    return YX5300_FAIL;
+  }
+
+  if (Handler->Batch.Count == 0)
+  {
+    Handler->Batch.State = YX5300_BATCH_IDLE;
+    YX5300_Unlock(Handler);
+    return YX5300_OK;
+  }
+
+#if (YX5300_USE_TX_QUEUE)
+  if (Handler->Tx.Count >= YX5300_TX_QUEUE_SIZE)
+  {
+    YX5300_Unlock(Handler);
+    return YX5300_QUEUE_FULL;
+  }
+#endif
+
+  // ACK of the last command confirms the batch
+  Last = &Handler->Batch.Buffer[(Handler->Batch.Count - 1) * YX5300_FRAME_SIZE];
+  YX5300_CodecEncode(Last, Last[3], Handler->Batch.Feedback, Last[5], Last[6],
+                     YX5300_USE_CHECKSUM);
+  Handler->Batch.State = YX5300_BATCH_PENDING;
+
+#if (YX5300_USE_TX_QUEUE)
+#if (YX5300_USE_TX_COALESCE)
+  // Commands of the batch are not predicted
+  Handler->Tx.Known = 0;
+#endif
+
+  Handler->Tx.Queue[Handler->Tx.Head].Command = YX5300_TX_BATCH;
+  Handler->Tx.Queue[Handler->Tx.Head].Feedback = Handler->Batch.Feedback;
+  Handler->Tx.Queue[Handler->Tx.Head].Data1 = 0;
+  Handler->Tx.Queue[Handler->Tx.Head].Data2 = 0;
+  Handler->Tx.Head = (Handler->Tx.Head + 1) % YX5300_TX_QUEUE_SIZE;
+  Handler->Tx.Count++;
+
+  YX5300_Unlock(Handler);
+  return YX5300_OK;
+#else
+  YX5300_Unlock(Handler);
+
+  // Platform layer may send the frames in several parts
+  while (Handler->Batch.Sent < Handler->Batch.Count)
+  {
+    if (Handler->Batch.Sent != 0)
+      Handler->Platform.Delay(Handler->Platform.UserCtx, YX5300_BATCH_GAP);
+
+    Result = YX5300_TransmitFrames(Handler,
+                                   &Handler->Batch.Buffer[Handler->Batch.Sent *
+                                                          YX5300_FRAME_SIZE],
+                                   Handler->Batch.Count - Handler->Batch.Sent,
+                                   &Sent);
+    if (Result != YX5300_OK)
+      break;
+    Handler->Batch.Sent += Sent;
+  }
+
+  YX5300_Lock(Handler);
+  Handler->Batch.State = YX5300_BATCH_IDLE;
+  YX5300_Unlock(Handler);
+
+  return Result;
+#endif
 }
+#endif
+
 
 
 /**
- * @brief  Play track by index
- * @param  Handler: Pointer to handler
- * @param  Track: Track number
+ ==================================================================================
+                             ##### Group Functions #####                           
+ ==================================================================================
+ */
+
+#if (YX5300_USE_GROUP)
+/**
+ * @brief  Initialize a group of handlers
+ * @note   Handlers must be initialized by YX5300_Init separately.
+ * @param  Group: Pointer to group
+ * @param  Handlers: Pointer to array of handlers
+ * @param  Count: Number of handlers in array
  * @retval YX5300_Result_t
  *         - YX5300_OK: Operation was successful.
- *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
  */
 YX5300_Result_t
-YX5300_PlayTrack(YX5300_Handler_t *Handler, uint16_t Track)
+YX5300_GroupInit(YX5300_Group_t *Group,
+                 YX5300_Handler_t *Handlers, uint8_t Count)
 {
-  return YX5300_SendCommand(Handler, YX5300_CMD_PLAY_INDEX,
-                            (uint8_t)(Track >> 8), (uint8_t)(Track & 0xFF));
+  if (Group == NULL || Handlers == NULL || Count == 0)
+    return YX5300_INVALID_PARAM;
+
+  Group->Handlers = Handlers;
+  Group->Count = Count;
+  Group->Next = 0;
+
+  return YX5300_OK;
 }
 
+
 /**
- * @brief  Play track by folder and file number
- * @param  Handler: Pointer to handler
- * @param  Folder: Folder number
- * @param  File: File number
+ * @brief  Process all handlers of a group
+ * @note   For each handler, the received data is read by Receive function of
+ *         platform (if linked) and parsed, then YX5300_Process is called. Each
+ *         handler gets at most one transmit slot per call and the handler that
+ *         is served first is changed on each call (round-robin).
+ * @param  Group: Pointer to group
  * @retval YX5300_Result_t
  *         - YX5300_OK: Operation was successful.
- *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_FAIL: Failed to send data for at least one handler.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
  */
 YX5300_Result_t
-YX5300_PlayFolderFile(YX5300_Handler_t *Handler, uint8_t Folder, uint8_t File)
+YX5300_GroupProcess(YX5300_Group_t *Group)
 {
-  return YX5300_SendCommand(Handler, YX5300_CMD_PLAY_FOLD_FILE, Folder, File);
+  YX5300_Result_t Result = YX5300_OK;
+  YX5300_Handler_t *Handler = NULL;
+  uint8_t Index = 0;
+  uint8_t i = 0;
+
+  if (Group == NULL || Group->Handlers == NULL)
+    return YX5300_INVALID_PARAM;
+
+  Index = Group->Next;
+  for (i = 0; i < Group->Count; i++)
+  {
+    Handler = &Group->Handlers[Index];
+
+    // Parse all received data before giving the transmit slot
+    while (YX5300_ReceivePending(Handler) != 0)
+      continue;
+
+    if (YX5300_Process(Handler) != YX5300_OK)
+      Result = YX5300_FAIL;
+
+    Index++;
+    if (Index >= Group->Count)
+      Index = 0;
+  }
+
+  Group->Next++;
+  if (Group->Next >= Group->Count)
+    Group->Next = 0;
+
+  return Result;
 }
+#endif
 
 
+#if (YX5300_USE_CODEC_API)
 /**
- * @brief  Pause playback
- * @param  Handler: Pointer to handler
+ ==================================================================================
+                         ##### Frame Codec Functions #####                         
+ ==================================================================================
+ */
+
+/**
+ * @brief  Encode a batch of frames into one buffer
+ * @note   This function only uses its parameters, so it is reentrant and can be
+ *         called from ISR.
+ * @param  Frames: Pointer to array of frames
+ * @param  Count: Number of frames
+ * @param  Checksum: 1 for frames with checksum, 0 for frames without it
+ * @param  Buffer: Pointer to output buffer
+ * @param  Size: Size of output buffer
+ * @param  Len: Pointer to store the number of written bytes
  * @retval YX5300_Result_t
  *         - YX5300_OK: Operation was successful.
- *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_FAIL: Buffer is too small (nothing is written).
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
  */
 YX5300_Result_t
-YX5300_Resume(YX5300_Handler_t *Handler)
+YX5300_EncodeFrame(const YX5300_Frame_t *Frames, uint8_t Count, uint8_t Checksum,
+                   uint8_t *Buffer, uint16_t Size, uint16_t *Len)
 {
-  return YX5300_SendCommand(Handler, YX5300_CMD_PLAY, 0, 0);
+  uint8_t FrameSize = Checksum ? YX5300_FRAME_SIZE_LONG : YX5300_FRAME_SIZE_SHORT;
+  uint16_t Index = 0;
+  uint8_t i = 0;
+
+  if (Frames == NULL || Buffer == NULL || Len == NULL)
+    return YX5300_INVALID_PARAM;
+
+  if ((uint32_t)Count * FrameSize > Size)
+    return YX5300_FAIL;
+
+  for (i = 0; i < Count; i++)
+    Index += YX5300_CodecEncode(&Buffer[Index], Frames[i].Command, Frames[i].Feedback,
+                                (uint8_t)(Frames[i].Data >> 8),
+                                (uint8_t)(Frames[i].Data & 0xFF), Checksum != 0);
+
+  *Len = Index;
+
+  return YX5300_OK;
 }
 
 
 /**
- * @brief  Pause playback
- * @param  Handler: Pointer to handler
+ * @brief  Initialize a frame decoder
+ * @param  Decoder: Pointer to decoder state
  * @retval YX5300_Result_t
  *         - YX5300_OK: Operation was successful.
- *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
  */
 YX5300_Result_t
-YX5300_Pause(YX5300_Handler_t *Handler)
+YX5300_DecoderInit(YX5300_Decoder_t *Decoder)
 {
-  return YX5300_SendCommand(Handler, YX5300_CMD_PAUSE, 0, 0);
+  if (Decoder == NULL)
+    return YX5300_INVALID_PARAM;
+
+  Decoder->BufferIndex = 0;
+  Decoder->InFrame = 0;
+
+  return YX5300_OK;
 }
 
 
 /**
- * @brief  Stop playback
- * @param  Handler: Pointer to handler
+ * @brief  Decode a stream of received bytes
+ * @note   Parsing stops right after the first complete or dropped frame. If
+ *         Consumed is less than Len, user should call this function again with
+ *         the rest of the data. Frames without checksum are accepted only if
+ *         YX5300_RX_SHORT_FRAMES is enabled.
+ * @note   This function only uses its parameters (the decoder state is given by
+ *         user), so it is reentrant and can be called from ISR. It does not
+ *         change any handler.
+ * @param  Decoder: Pointer to decoder state initialized by YX5300_DecoderInit
+ * @param  Data: Pointer to received data
+ * @param  Len: Number of received bytes
+ * @param  Consumed: Pointer to store the number of parsed bytes (can be NULL)
+ * @param  Frame: Pointer to store the decoded frame
  * @retval YX5300_Result_t
- *         - YX5300_OK: Operation was successful.
- *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_OK: All bytes parsed and no frame completed.
+ *         - YX5300_FAIL: A broken frame is dropped.
+ *         - YX5300_RX_COMPLETE: A frame is decoded into Frame.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
  */
 YX5300_Result_t
-YX5300_Stop(YX5300_Handler_t *Handler)
+YX5300_DecodeFrame(YX5300_Decoder_t *Decoder,
+                   const uint8_t *Data, uint16_t Len, uint16_t *Consumed,
+                   YX5300_Frame_t *Frame)
 {
-  return YX5300_SendCommand(Handler, YX5300_CMD_STOP, 0, 0);
+  YX5300_Result_t Result = YX5300_OK;
+  uint16_t i = 0;
+
+  if (Decoder == NULL || Data == NULL || Frame == NULL)
+    return YX5300_INVALID_PARAM;
+
+  for (i = 0; i < Len; i++)
+  {
+    switch (YX5300_CodecDecode(Decoder, Data[i], YX5300_RX_SHORT_FRAMES))
+    {
+    case YX5300_DECODE_FRAME:
+      Frame->Command = Decoder->Buffer[3];
+      Frame->Feedback = Decoder->Buffer[4];
+      Frame->Data = (Decoder->Buffer[5] << 8) | Decoder->Buffer[6];
+      Result = YX5300_RX_COMPLETE;
+      break;
+
+    case YX5300_DECODE_DROP:
+      Result = YX5300_FAIL;
+      break;
+
+    default:
+      continue;
+    }
+
+    i++;
+    break;
+  }
+
+  if (Consumed)
+    *Consumed = i;
+
+  return Result;
 }
+#endif
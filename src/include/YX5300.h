@@ -38,12 +38,28 @@ extern "C" {
 
 
 /* Includes ---------------------------------------------------------------------*/
+#include "YX5300_config.h"
+#include "YX5300_codec.h"
 #include <stdint.h>
 
 
 /* Exported Constants -----------------------------------------------------------*/
 #define YX5300_RESPONSE_SIZE          10
 
+/**
+ * @brief  Size of command frames
+ */
+#if (YX5300_USE_CHECKSUM)
+#define YX5300_FRAME_SIZE             YX5300_FRAME_SIZE_LONG
+#else
+#define YX5300_FRAME_SIZE             YX5300_FRAME_SIZE_SHORT
+#endif
+
+/**
+ * @brief  Size of media library snapshot for a number of folders
+ */
+#define YX5300_LIBRARY_SNAPSHOT_SIZE(FOLDERS)   (5 + (FOLDERS))
+
 
 /* Exported Data Types ----------------------------------------------------------*/
 /**
@@ -55,48 +71,200 @@ typedef enum YX5300_Result_e
   YX5300_FAIL            = 1,
   YX5300_INVALID_PARAM   = 2,
   YX5300_RX_COMPLETE     = 3,
+  YX5300_QUEUE_FULL      = 4,
+  YX5300_TIMEOUT         = 5,
 } YX5300_Result_t;
 
 
+/**
+ * @brief  Feedback (ACK) mode of commands
+ */
+typedef enum YX5300_Feedback_e
+{
+  YX5300_FEEDBACK_DEFAULT  = 0,
+  YX5300_FEEDBACK_ENABLE   = 1,
+  YX5300_FEEDBACK_DISABLE  = 2,
+} YX5300_Feedback_t;
+
+
+/**
+ * @brief  Playlist play modes
+ */
+typedef enum YX5300_PlayMode_e
+{
+  YX5300_PLAYMODE_SEQUENTIAL  = 0, // Play items in order and stop at the end
+  YX5300_PLAYMODE_REPEAT      = 1, // Play items in order and repeat from first
+  YX5300_PLAYMODE_SHUFFLE     = 2, // Play random items endlessly
+} YX5300_PlayMode_t;
+
+
+/**
+ * @brief  States of the media library index
+ */
+typedef enum YX5300_LibraryState_e
+{
+  YX5300_LIBRARY_EMPTY     = 0, // No index (not scanned or memory card removed)
+  YX5300_LIBRARY_SCANNING  = 1, // Folders are being queried
+  YX5300_LIBRARY_READY     = 2, // Index is complete
+} YX5300_LibraryState_t;
+
+
+/**
+ * @brief  Event types
+ */
+typedef enum YX5300_EventType_e
+{
+  YX5300_EVENT_CARD_INSERTED   = 0,  // Memory card inserted (0x3A)
+  YX5300_EVENT_CARD_REMOVED    = 1,  // Memory card removed (0x3B)
+  YX5300_EVENT_TRACK_FINISHED  = 2,  // Completed play of track 'Data' (0x3D)
+  YX5300_EVENT_INIT_DONE       = 3,  // Initialization done, online devices 'Data' (0x3F)
+  YX5300_EVENT_ERROR           = 4,  // Error 'Data' for last command (0x40)
+  YX5300_EVENT_ACK             = 5,  // Last command received correctly (0x41)
+  YX5300_EVENT_STATUS          = 6,  // Reply of status query (0x42)
+  YX5300_EVENT_VOLUME          = 7,  // Reply of volume query (0x43)
+  YX5300_EVENT_TOTAL_TRACKS    = 8,  // Reply of total tracks query (0x48)
+  YX5300_EVENT_TRACK           = 9,  // Reply of playing track query (0x4C)
+  YX5300_EVENT_FOLDER_TRACKS   = 10, // Reply of folder tracks query (0x4E)
+  YX5300_EVENT_FOLDER_COUNT    = 11, // Reply of folder count query (0x4F)
+} YX5300_EventType_t;
+
+
+/**
+ * @brief  Event data type
+ */
+typedef struct YX5300_Event_s
+{
+  YX5300_EventType_t Type;
+  uint8_t  Response;  // Response code
+  uint8_t  Command;   // Last sent command
+  uint16_t Data;      // Response data
+} YX5300_Event_t;
+
+
+struct YX5300_Handler_s;
+
+/**
+ * @brief  Function type for event callback.
+ * @param  Handler: Pointer to handler
+ * @param  Event: Pointer to event data
+ */
+typedef void (*YX5300_EventCallback_t)(struct YX5300_Handler_s *Handler,
+                                       const YX5300_Event_t *Event);
+
+
 /**
  * @brief  Function type for Initialize/Deinitialize the platform dependent layer.
+ * @param  UserCtx: User context of platform dependent layer
  * @retval 
  *         -  0: The operation was successful.
  *         - -1: The operation failed. 
  */
-typedef int8_t (*YX5300_Platform_InitDeinit_t)(void);
+typedef int8_t (*YX5300_Platform_InitDeinit_t)(void *UserCtx);
 
 /**
  * @brief  Function type for Delay.
+ * @param  UserCtx: User context of platform dependent layer
+ * @param  Delay: Delay in ms
  * @retval 
  *         -  0: The operation was successful.
  *         - -1: The operation failed. 
  */
-typedef int8_t (*YX5300_Platform_Delay_t)(uint16_t Delay);
+typedef int8_t (*YX5300_Platform_Delay_t)(void *UserCtx, uint16_t Delay);
 
 /**
  * @brief  Function type for Send data through UART.
+ * @note   If YX5300_USE_BATCH is enabled, Data may contain several frames of
+ *         YX5300_FRAME_SIZE bytes. The platform layer must leave a gap of
+ *         YX5300_BATCH_GAP ms between them, because the module drops the frames
+ *         that are received while it is busy. It can also send only the first
+ *         frames and return their number. Then the driver sends the rest after
+ *         the gap. If sending fails after some frames, their number must be
+ *         returned too, so they are not sent again.
+ * @param  UserCtx: User context of platform dependent layer
  * @param  Data: Pointer to data to send
  * @param  Len: data len in Bytes
  * @retval 
  *         -  0: The operation was successful.
  *         - -1: Failed to send.
+ *         - N > 0: Only the first N frames of a batch are sent.
  */
-typedef int8_t (*YX5300_Platform_Send_t)(uint8_t *Data,
+typedef int8_t (*YX5300_Platform_Send_t)(void *UserCtx,
+                                         uint8_t *Data,
                                          uint8_t Len);
 
+/**
+ * @brief  Function type for Receive data from UART.
+ * @note   This function must not block. It must return the already received
+ *         bytes (or no bytes) immediately.
+ * @param  UserCtx: User context of platform dependent layer
+ * @param  Data: Pointer to buffer to store received data
+ * @param  Size: Size of buffer in Bytes
+ * @param  Len: Pointer to store the number of received bytes
+ * @retval 
+ *         -  0: The operation was successful.
+ *         - -1: Failed to receive.
+ */
+typedef int8_t (*YX5300_Platform_Receive_t)(void *UserCtx,
+                                            uint8_t *Data,
+                                            uint8_t Size,
+                                            uint8_t *Len);
+
+/**
+ * @brief  Function type for Lock/Unlock the handler.
+ * @note   Lock is held only for a few instructions. It may be called from the
+ *         context that calls YX5300_Rx (e.g. UART interrupt), so a spinlock or
+ *         critical section is preferred to a mutex.
+ * @param  UserCtx: User context of platform dependent layer
+ */
+typedef void (*YX5300_Platform_Lock_t)(void *UserCtx);
+
+/**
+ * @brief  Function type for Yield the CPU while waiting for a response.
+ * @note   It is called instead of Delay(1) by the waits that poll for the
+ *         responses (queries and initialization), so it does not need to be
+ *         accurate. It should let the other tasks (e.g. the task that receives
+ *         the responses) run, e.g. by sleeping for one RTOS tick.
+ * @param  UserCtx: User context of platform dependent layer
+ */
+typedef void (*YX5300_Platform_Yield_t)(void *UserCtx);
+
+/**
+ * @brief  Function type for Get the time since startup.
+ * @note   The time must be monotonic with 1 ms resolution. All timeouts of the
+ *         driver are deadlines based on this time.
+ * @param  UserCtx: User context of platform dependent layer
+ * @retval Time in ms
+ */
+typedef uint32_t (*YX5300_Platform_GetTick_t)(void *UserCtx);
+
 /**
  * @brief  Platform dependent layer data type
  * @note   It is optional to initialize this functions:
+ *         - UserCtx
  *         - Init
  *         - DeInit
+ *         - Receive (If it is not initialized, user must pass received data to
+ *                    YX5300_Rx or YX5300_RxBuffer)
+ *         - GetTick (If YX5300_USE_TX_QUEUE is disabled. If it is not
+ *                    initialized, timeouts are counted by calling Delay(1))
+ *         - Lock and Unlock (Only if commands are sent and YX5300_Rx or
+ *                           YX5300_RxBuffer is called from the same single
+ *                           context. Rx from an ISR or another task is a
+ *                           second writer of the handler, so they are
+ *                           mandatory then.)
+ *         - Yield (If it is not initialized, Delay(1) is called while waiting
+ *                  for a response. It is only used if GetTick is initialized)
  * @note   It is mandatory to initialize this functions:
+ *         - Delay
  *         - Send
- *         - Receive
+ *         - GetTick (Only if YX5300_USE_TX_QUEUE is enabled)
  * @note   If success the functions must return 0 
  */
 typedef struct YX5300_Platform_s
 {
+  // User context that is passed to all functions (e.g. UART instance)
+  void *UserCtx;
+
   // Initialize platform dependent layer
   YX5300_Platform_InitDeinit_t Init;
   // De-initialize platform dependent layer
@@ -107,9 +275,78 @@ typedef struct YX5300_Platform_s
 
   // Send data
   YX5300_Platform_Send_t Send;
+
+  // Receive data
+  YX5300_Platform_Receive_t Receive;
+
+  // Get time in ms
+  YX5300_Platform_GetTick_t GetTick;
+
+  // Lock/Unlock handler (Tx queue and status) when it is used from several
+  // contexts
+  YX5300_Platform_Lock_t Lock;
+  YX5300_Platform_Lock_t Unlock;
+
+  // Yield CPU while waiting for a response
+  YX5300_Platform_Yield_t Yield;
 } YX5300_Platform_t;
 
 
+/**
+ * @brief  Status data type
+ */
+typedef struct YX5300_Status_s
+{
+  uint8_t  LastCommand;
+  uint8_t  LastResponse;
+  uint16_t LastCommandData;
+  uint16_t LastResponseData;
+
+  uint8_t Volume;
+  uint16_t Track; // if 0, it means no track is playing
+  uint16_t TotalTracks;
+  uint8_t StatusByte; // 0x00: Stop, 0x01: Play, 0x02: Pause
+
+  uint8_t MemoryInserted;
+} YX5300_Status_t;
+
+
+/**
+ * @brief  Link statistics data type
+ */
+typedef struct YX5300_Stats_s
+{
+  uint32_t FramesSent;
+  uint32_t BytesSent;
+  uint32_t FramesReceived;
+  uint32_t ParseFailures;   // Frames with unrecognized response code
+  uint32_t Resyncs;         // Broken frames dropped by the receiver
+  uint32_t ErrorResponses;  // Error (0x40) responses
+  uint32_t AckTimeouts;     // Queued commands with no ACK in the ACK timeout
+  uint32_t Retries;         // Commands sent again because of no response
+
+  // Time from sending a command with feedback to receiving its ACK in ms
+  // (GetTick must be linked)
+  uint32_t AckCount;
+  uint32_t AckLatencySum;
+  uint16_t AckLatencyMin;
+  uint16_t AckLatencyAvg;   // Calculated by YX5300_GetStats
+  uint16_t AckLatencyMax;
+} YX5300_Stats_t;
+
+
+/**
+ * @brief  Playback position data type
+ */
+typedef struct YX5300_Position_s
+{
+  uint32_t Elapsed;   // Play time of current track in ms
+  uint32_t Duration;  // Length of current track in ms (0: Unknown)
+  uint16_t Track;     // Playing track (0: Unknown)
+  uint8_t  State;     // 0x00: Stop, 0x01: Play, 0x02: Pause
+} YX5300_Position_t;
+
+
 /**
  * @brief  Handler data type
  * @note   User must initialize platform dependent layer functions
@@ -120,31 +357,208 @@ typedef struct YX5300_Handler_s
   YX5300_Platform_t Platform;
 
   // Rx Handler
+  YX5300_Decoder_t Rx;
+
+#if (YX5300_USE_EVENTS)
+  // Event callback
+  YX5300_EventCallback_t EventCallback;
+#endif
+
+  // Feedback mode
   struct
   {
-    uint8_t Buffer[YX5300_RESPONSE_SIZE];
-    uint8_t BufferIndex;
-    uint8_t InFrame;
-  } Rx;
+    uint8_t Default;
+    uint8_t Next;
+  } Feedback;
 
-  // Status
+  // Response that a query function is waiting for
+  struct
+  {
+    volatile uint8_t Code[2];
+    volatile uint8_t Received; // Received code (0: none)
+  } Wait;
+
+#if (YX5300_USE_PLAYLIST)
+  // Playlist
+  struct
+  {
+    struct
+    {
+      uint8_t  Folder;  // if 0, File is the track number
+      uint8_t  Volume;  // if 0, volume is not changed
+      uint16_t File;    // if 0 (and Folder is not 0), the folder is repeated
+    } Items[YX5300_PLAYLIST_SIZE];
+    uint8_t  Count;
+    uint8_t  Index;
+    uint8_t  Mode;
+    uint8_t  Active;
+    uint8_t  Pending;   // A play command is sent and its completion is waited
+    uint32_t PlayTick;  // Time of the last play command
+    uint32_t Seed;
+  } Playlist;
+#endif
+
+#if (YX5300_USE_LIBRARY)
+  // Media library index
+  struct
+  {
+    uint8_t *Table;   // Number of files in each folder (folder 1 at index 0)
+    uint8_t  Size;    // Number of entries in Table
+    uint8_t  Folders; // Number of indexed folders
+    uint16_t Total;   // Total tracks of the card the Table belongs to (0: none)
+    uint8_t  Next;    // Folder that is being queried
+    uint8_t  Pending; // Response that the scan is waiting for
+    uint8_t  Retries; // Number of times the pending query is sent again
+    uint32_t SendTick; // Time of sending the pending query
+    uint8_t  State;   // YX5300_LibraryState_t
+  } Library;
+#endif
+
+#if (YX5300_USE_CACHE)
+  // Cached state
+  struct
+  {
+    uint8_t  Valid;   // Bit mask of values confirmed by the module
+    uint8_t  Folder;  // Folder of the last played folder/file
+    uint8_t  File;    // File of the last played folder/file
+    uint32_t Tick[4]; // Time of the confirmation of each value
+  } Cache;
+#endif
+
+#if (YX5300_USE_TX_QUEUE)
+  // Tx Handler
+  struct
+  {
+    struct
+    {
+      uint8_t Command;
+      uint8_t Feedback;
+      uint8_t Data1;
+      uint8_t Data2;
+    } Queue[YX5300_TX_QUEUE_SIZE];
+    uint8_t Head;
+    uint8_t Tail;
+    uint8_t Count;
+    volatile uint8_t WaitAck;  // 1: Waiting for ACK, 2: Gap of no ACK command
+    uint8_t Sending;           // 1: Normal lane, 2: Urgent lane
+#if (YX5300_USE_TX_PRIORITY)
+    struct
+    {
+      uint8_t Command;
+      uint8_t Feedback;
+      uint8_t Data1;
+      uint8_t Data2;
+    } Urgent[YX5300_TX_URGENT_SIZE];
+    uint8_t UrgentHead;
+    uint8_t UrgentTail;
+    uint8_t UrgentCount;
+    uint8_t NextUrgent;        // Next command is put into the urgent lane
+#endif
+#if (YX5300_USE_TX_COALESCE)
+    uint8_t Known;   // Bit mask of predicted values (0x01: Volume, 0x02: Track)
+    uint8_t Volume;  // Volume after sending all queued commands
+    uint16_t Track;  // Track after sending all queued commands
+#endif
+#if (YX5300_USE_TX_RETRY)
+    struct
+    {
+      uint8_t Command;
+      uint8_t Feedback;
+      uint8_t Data1;
+      uint8_t Data2;
+#if (YX5300_USE_TX_PRIORITY)
+      uint8_t Lane;  // 1: Normal, 2: Urgent
+#endif
+    } Last;          // Sent command that is waiting for ACK
+    uint8_t Retry;   // Last command must be sent again
+    uint8_t Retries; // Number of retries of last command
+    uint16_t Srtt;   // Smoothed ACK round-trip time in 1/8 ms (0: Unknown)
+    uint16_t Rttvar; // Variation of ACK round-trip time in 1/4 ms
+#endif
+    uint16_t AckTimeout;
+    uint16_t Timeout;
+    uint32_t SendTick;
+  } Tx;
+#endif
+
+#if (YX5300_USE_TX_QUEUE && YX5300_USE_FADE)
+  // Volume fade
+  struct
+  {
+    uint8_t  Active;
+    uint8_t  Start;     // Volume at the start of fade (0xFF: Not known yet)
+    uint8_t  Target;
+    uint8_t  Volume;    // Last volume that is queued by the fade
+    uint8_t  Current;   // Last volume that is sent or confirmed (0xFF: Unknown)
+    uint16_t Duration;  // ms
+    uint32_t StartTick;
+  } Fade;
+#endif
+
+#if (YX5300_USE_BATCH)
+  // Batch of commands
+  struct
+  {
+    uint8_t Buffer[YX5300_BATCH_SIZE * YX5300_FRAME_SIZE];
+    uint8_t Count;    // Number of frames in Buffer
+    uint8_t Sent;     // Number of frames that are sent
+    uint8_t Feedback; // Feedback of the last command
+    uint8_t State;    // 0: Idle, 1: Recording, 2: Waiting to be sent
+  } Batch;
+#endif
+
+#if (YX5300_USE_POSITION)
+  // Playback position
   struct
   {
-    uint8_t  LastCommand;
-    uint8_t  LastResponse;
-    uint16_t LastCommandData;
-    uint16_t LastResponseData;
+    const uint16_t *Durations; // Length of each track in s (track 1 at index 0)
+    uint16_t Size;             // Number of entries in Durations
+    uint16_t Track;            // Playing track (0: Unknown)
+    uint8_t  State;            // 0x00: Stop, 0x01: Play, 0x02: Pause
+    uint8_t  Cycle;            // 0: None, 1: Track is repeated, 2: Folder is repeated
+    uint32_t StartTick;        // Tick of position 0 (moved forward by pauses)
+    uint32_t PauseTick;
+  } Position;
+#endif
 
-    uint8_t Volume;
-    uint16_t Track; // if 0, it means no track is playing
-    uint8_t StatusByte; // 0x00: Stop, 0x01: Play, 0x02: Pause
+#if (YX5300_USE_STATS)
+  // Link statistics
+  struct
+  {
+    YX5300_Stats_t Counters;
+    uint32_t SendTick;
+    uint8_t  WaitAck;
+  } Stats;
+#endif
 
-    uint8_t MemoryInserted;
-  } Status;
+  // Status
+  YX5300_Status_t Status;
+  volatile uint32_t StatusSeq;
 } YX5300_Handler_t;
 
 
+#if (YX5300_USE_GROUP)
+/**
+ * @brief  Group of handlers that are processed by one context
+ */
+typedef struct YX5300_Group_s
+{
+  YX5300_Handler_t *Handlers;
+  uint8_t Count;
+  uint8_t Next;
+} YX5300_Group_t;
+#endif
+
+
 /* Exported Macros --------------------------------------------------------------*/
+/**
+ * @brief  Link user context of platform dependent layer to handler
+ * @param  HANDLER: Pointer to handler
+ * @param  CTX: Pointer to user context
+ */
+#define YX5300_PLATFORM_LINK_USERCTX(HANDLER, CTX) \
+  (HANDLER)->Platform.UserCtx = (CTX)
+
 /**
  * @brief  Link platform dependent layer functions to handler
  * @param  HANDLER: Pointer to handler
@@ -177,6 +591,42 @@ typedef struct YX5300_Handler_s
 #define YX5300_PLATFORM_LINK_SEND(HANDLER, FUNC) \
   (HANDLER)->Platform.Send = FUNC
 
+/**
+ * @brief  Link platform dependent layer functions to handler
+ * @param  HANDLER: Pointer to handler
+ * @param  FUNC: Function name
+ */
+#define YX5300_PLATFORM_LINK_RECEIVE(HANDLER, FUNC) \
+  (HANDLER)->Platform.Receive = FUNC
+
+/**
+ * @brief  Link platform dependent layer functions to handler
+ * @param  HANDLER: Pointer to handler
+ * @param  FUNC: Function name
+ */
+#define YX5300_PLATFORM_LINK_GETTICK(HANDLER, FUNC) \
+  (HANDLER)->Platform.GetTick = FUNC
+
+/**
+ * @brief  Link platform dependent layer functions to handler
+ * @param  HANDLER: Pointer to handler
+ * @param  LOCK: Lock function name
+ * @param  UNLOCK: Unlock function name
+ */
+#define YX5300_PLATFORM_LINK_LOCK(HANDLER, LOCK, UNLOCK) \
+  do {                                                   \
+    (HANDLER)->Platform.Lock = LOCK;                     \
+    (HANDLER)->Platform.Unlock = UNLOCK;                 \
+  } while (0)
+
+/**
+ * @brief  Link platform dependent layer functions to handler
+ * @param  HANDLER: Pointer to handler
+ * @param  FUNC: Function name
+ */
+#define YX5300_PLATFORM_LINK_YIELD(HANDLER, FUNC) \
+  (HANDLER)->Platform.Yield = FUNC
+
 
 
 /**
@@ -189,10 +639,15 @@ typedef struct YX5300_Handler_s
  * @brief  Initializer function
  * @note   This function must be called after initializing platform dependent
  *         layer and before using other functions.
+ * @note   If YX5300_USE_FAST_INIT is enabled, the device selection is checked
+ *         too, so a missing module or memory card is reported.
  * @param  Handler: Pointer to handler
  * @retval YX5300_Result_t
  *         - YX5300_OK: Operation was successful.
- *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_FAIL: Failed to send or receive data, or the module reported
+ *                        an error for the device selection (no memory card).
+ *         - YX5300_TIMEOUT: The module did not answer the device selection
+ *                           (only if YX5300_USE_FAST_INIT is enabled).
  *         - YX5300_INVALID_PARAM: Invalid parameter.
  */
 YX5300_Result_t
@@ -223,6 +678,47 @@ YX5300_Result_t
 YX5300_Rx(YX5300_Handler_t *Handler, uint8_t Data);
 
 
+/**
+ * @brief  Rx callback function for a block of received data
+ * @note   All bytes are parsed in one call. Each complete frame updates the
+ *         status (and dispatches its event) as soon as it is parsed.
+ * @param  Handler: Pointer to handler
+ * @param  Data: Pointer to received data
+ * @param  Len: Number of received bytes
+ * @param  Frames: Pointer to store the number of complete frames (can be NULL)
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: All bytes parsed and no frame completed.
+ *         - YX5300_FAIL: At least one frame was dropped or failed to parse.
+ *         - YX5300_RX_COMPLETE: At least one frame received successfully and
+ *                               status updated.
+ */
+YX5300_Result_t
+YX5300_RxBuffer(YX5300_Handler_t *Handler,
+                const uint8_t *Data, uint16_t Len, uint16_t *Frames);
+
+
+/**
+ * @brief  Process function
+ * @note   This function must be called periodically when YX5300_USE_TX_QUEUE is
+ *         enabled. It sends the queued commands one by one. Each command is sent
+ *         after the ACK of the previous command is received or the ACK timeout
+ *         (YX5300_TX_ACK_TIMEOUT or the value set by YX5300_SetAckTimeout) is
+ *         expired.
+ * @note   If YX5300_USE_TX_RETRY is enabled, a command that gets no ACK or gets a
+ *         transient error is sent again before the next queued command, and the
+ *         ACK timeout is computed from the measured ACK round-trip time.
+ * @note   If YX5300_USE_LIBRARY is enabled, this function must also be called
+ *         periodically during a library scan to send the lost queries again.
+ * @note   If YX5300_USE_TX_QUEUE is disabled, this function does nothing.
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send data.
+ */
+YX5300_Result_t
+YX5300_Process(YX5300_Handler_t *Handler);
+
+
 
 /**
  ==================================================================================
@@ -235,10 +731,13 @@ YX5300_Rx(YX5300_Handler_t *Handler, uint8_t Data);
  * @note   After calling this function, user should wait for YX5300_RX_COMPLETE of
  *         YX5300_Rx callback function to be called. Then user can check the
  *         StatusByte in handler to see the current status.
+ * @note   If YX5300_USE_CACHE is enabled and the cached value is fresh, no query
+ *         is sent and the value in handler is already up to date.
  * @param  Handler: Pointer to handler
  * @retval YX5300_Result_t
  *         - YX5300_OK: Operation was successful.
  *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
  */
 YX5300_Result_t
 YX5300_UpdateStatus(YX5300_Handler_t *Handler);
@@ -249,11 +748,14 @@ YX5300_UpdateStatus(YX5300_Handler_t *Handler);
  * @note   After calling this function, user should wait for YX5300_RX_COMPLETE of
  *         YX5300_Rx callback function to be called. Then user can check the
  *         Volume in handler to see the current volume level.
+ * @note   If YX5300_USE_CACHE is enabled and the cached value is fresh, no query
+ *         is sent and the value in handler is already up to date.
  * @param  Handler: Pointer to handler
  * @retval YX5300_Result_t
  *         - YX5300_OK: Operation was successful.
  *         - YX5300_FAIL: Failed to send or receive data.
  *         - YX5300_INVALID_PARAM: Invalid parameter.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
  */
 YX5300_Result_t
 YX5300_UpdateVolume(YX5300_Handler_t *Handler);
@@ -264,135 +766,898 @@ YX5300_UpdateVolume(YX5300_Handler_t *Handler);
  * @note   After calling this function, user should wait for YX5300_RX_COMPLETE of
  *         YX5300_Rx callback function to be called. Then user can check the
  *         Track in handler to see the current track number.
+ * @note   If YX5300_USE_CACHE is enabled and the cached value is fresh, no query
+ *         is sent and the value in handler is already up to date.
  * @param  Handler: Pointer to handler
  * @retval YX5300_Result_t
  *         - YX5300_OK: Operation was successful.
  *         - YX5300_FAIL: Failed to send or receive data.
  *         - YX5300_INVALID_PARAM: Invalid parameter.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
  */
 YX5300_Result_t
 YX5300_UpdateTrack(YX5300_Handler_t *Handler);
 
 
-
 /**
- ==================================================================================
-                        ##### Media Control Functions #####                        
- ==================================================================================
+ * @brief  Query current status and wait for the response
+ * @note   This function returns as soon as the response of module is parsed.
+ *         If YX5300_USE_CACHE is enabled and the cached value is fresh, it
+ *         returns the cached value without sending the query.
+ *         If Receive function of platform is not linked, user must pass the
+ *         received data to YX5300_Rx or YX5300_RxBuffer from another context
+ *         (e.g. UART interrupt).
+ * @param  Handler: Pointer to handler
+ * @param  Status: Pointer to store the status (0x00: Stop, 0x01: Play, 0x02: Pause)
+ * @param  Timeout: Maximum time to wait for the response in ms
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ *         - YX5300_TIMEOUT: No response received in Timeout.
  */
+YX5300_Result_t
+YX5300_QueryStatus(YX5300_Handler_t *Handler, uint8_t *Status, uint16_t Timeout);
+
 
 /**
- * @brief  Play next track
+ * @brief  Query current volume level and wait for the response
+ * @note   This function returns as soon as the response of module is parsed.
+ *         If YX5300_USE_CACHE is enabled and the cached value is fresh, it
+ *         returns the cached value without sending the query.
+ *         If Receive function of platform is not linked, user must pass the
+ *         received data to YX5300_Rx or YX5300_RxBuffer from another context
+ *         (e.g. UART interrupt).
  * @param  Handler: Pointer to handler
+ * @param  Volume: Pointer to store the volume level
+ * @param  Timeout: Maximum time to wait for the response in ms
  * @retval YX5300_Result_t
  *         - YX5300_OK: Operation was successful.
  *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ *         - YX5300_TIMEOUT: No response received in Timeout.
  */
 YX5300_Result_t
-YX5300_PlayNext(YX5300_Handler_t *Handler);
+YX5300_QueryVolume(YX5300_Handler_t *Handler, uint8_t *Volume, uint16_t Timeout);
 
 
 /**
- * @brief  Play previous track
+ * @brief  Query current track number and wait for the response
+ * @note   This function returns as soon as the response of module is parsed.
+ *         If YX5300_USE_CACHE is enabled and the cached value is fresh, it
+ *         returns the cached value without sending the query.
+ *         If Receive function of platform is not linked, user must pass the
+ *         received data to YX5300_Rx or YX5300_RxBuffer from another context
+ *         (e.g. UART interrupt).
  * @param  Handler: Pointer to handler
+ * @param  Track: Pointer to store the track number
+ * @param  Timeout: Maximum time to wait for the response in ms
  * @retval YX5300_Result_t
  *         - YX5300_OK: Operation was successful.
  *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ *         - YX5300_TIMEOUT: No response received in Timeout.
  */
 YX5300_Result_t
-YX5300_PlayPrev(YX5300_Handler_t *Handler);
+YX5300_QueryTrack(YX5300_Handler_t *Handler, uint16_t *Track, uint16_t Timeout);
 
 
 /**
- * @brief  Increase volume one step
+ * @brief  Get a consistent copy of status
+ * @note   This function does not take the lock at first. It can be called from
+ *         another context while the status is being updated by YX5300_Rx. It
+ *         retries the copy if the status is updated meanwhile, at most
+ *         YX5300_SNAPSHOT_RETRIES times. Then it copies the status under the lock.
  * @param  Handler: Pointer to handler
+ * @param  Status: Pointer to store the copy of status
  * @retval YX5300_Result_t
  *         - YX5300_OK: Operation was successful.
- *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_FAIL: Status was being updated during all retries and Lock
+ *                        is not linked.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
  */
 YX5300_Result_t
-YX5300_VolumeUp(YX5300_Handler_t *Handler);
+YX5300_GetStatusSnapshot(YX5300_Handler_t *Handler, YX5300_Status_t *Status);
 
 
+#if (YX5300_USE_STATS)
 /**
- * @brief  Decrease volume one step
+ * @brief  Get a copy of link statistics
  * @param  Handler: Pointer to handler
+ * @param  Stats: Pointer to store the statistics
  * @retval YX5300_Result_t
  *         - YX5300_OK: Operation was successful.
- *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
  */
 YX5300_Result_t
-YX5300_VolumeDown(YX5300_Handler_t *Handler);
+YX5300_GetStats(YX5300_Handler_t *Handler, YX5300_Stats_t *Stats);
 
 
 /**
- * @brief  Set volume level
+ * @brief  Reset all link statistics to zero
  * @param  Handler: Pointer to handler
- * @param  Volume: Volume level (0-30)
  * @retval YX5300_Result_t
  *         - YX5300_OK: Operation was successful.
- *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
  */
 YX5300_Result_t
-YX5300_SetVolume(YX5300_Handler_t *Handler, uint8_t Volume);
+YX5300_ResetStats(YX5300_Handler_t *Handler);
+#endif
 
 
+#if (YX5300_USE_POSITION)
 /**
- * @brief  Play track by index
+ * @brief  Get the estimated position of the playing track
+ * @note   The module does not report the position, so it is counted locally
+ *         from the ACKs of play, pause, resume and stop commands and the
+ *         completed play response. No frame is sent. The position is only known
+ *         for the commands that are sent with feedback.
+ * @note   The track number of the next/previous track is only known if the
+ *         current track and the total number of tracks are known. Folder/file
+ *         commands are converted to track numbers by the media library index if
+ *         it is ready.
+ * @param  Handler: Pointer to handler
+ * @param  Position: Pointer to store the position
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: GetTick is not linked.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_GetPosition(YX5300_Handler_t *Handler, YX5300_Position_t *Position);
+
+
+/**
+ * @brief  Set the table of track lengths
+ * @note   The table is not copied and must stay valid. It is used to fill the
+ *         Duration of YX5300_GetPosition and to limit the Elapsed time.
+ * @param  Handler: Pointer to handler
+ * @param  Durations: Length of each track in seconds (track 1 at index 0). NULL
+ *                    removes the table.
+ * @param  Size: Number of entries in Durations
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_SetTrackDurations(YX5300_Handler_t *Handler,
+                         const uint16_t *Durations, uint16_t Size);
+#endif
+
+
+#if (YX5300_USE_CACHE)
+/**
+ * @brief  Invalidate all cached values
+ * @note   Call this function if the state of module may be changed without
+ *         this driver (e.g. the module is reset by hardware).
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_CacheInvalidate(YX5300_Handler_t *Handler);
+#endif
+
+
+
+/**
+ ==================================================================================
+                        ##### Media Control Functions #####                        
+ ==================================================================================
+ */
+
+/**
+ * @brief  Play next track
  * @param  Handler: Pointer to handler
- * @param  Track: Track number
  * @retval YX5300_Result_t
  *         - YX5300_OK: Operation was successful.
  *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
  */
 YX5300_Result_t
-YX5300_PlayTrack(YX5300_Handler_t *Handler, uint16_t Track);
+YX5300_PlayNext(YX5300_Handler_t *Handler);
 
 
 /**
- * @brief  Play track by folder and file number
+ * @brief  Play previous track
  * @param  Handler: Pointer to handler
- * @param  Folder: Folder number
- * @param  File: File number
  * @retval YX5300_Result_t
  *         - YX5300_OK: Operation was successful.
  *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
  */
 YX5300_Result_t
-YX5300_PlayFolderFile(YX5300_Handler_t *Handler, uint8_t Folder, uint8_t File);
+YX5300_PlayPrev(YX5300_Handler_t *Handler);
 
 
 /**
- * @brief  Pause playback
+ * @brief  Increase volume one step
  * @param  Handler: Pointer to handler
  * @retval YX5300_Result_t
  *         - YX5300_OK: Operation was successful.
  *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
  */
 YX5300_Result_t
-YX5300_Resume(YX5300_Handler_t *Handler);
+YX5300_VolumeUp(YX5300_Handler_t *Handler);
 
 
 /**
- * @brief  Pause playback
+ * @brief  Decrease volume one step
  * @param  Handler: Pointer to handler
  * @retval YX5300_Result_t
  *         - YX5300_OK: Operation was successful.
  *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
  */
 YX5300_Result_t
-YX5300_Pause(YX5300_Handler_t *Handler);
+YX5300_VolumeDown(YX5300_Handler_t *Handler);
 
 
 /**
- * @brief  Stop playback
+ * @brief  Set volume level
+ * @note   If YX5300_USE_CACHE is enabled and the module is known to be in the
+ *         requested state, the command is not sent.
  * @param  Handler: Pointer to handler
+ * @param  Volume: Volume level (0-30)
  * @retval YX5300_Result_t
  *         - YX5300_OK: Operation was successful.
  *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
  */
 YX5300_Result_t
-YX5300_Stop(YX5300_Handler_t *Handler);
+YX5300_SetVolume(YX5300_Handler_t *Handler, uint8_t Volume);
+
+
+#if (YX5300_USE_TX_QUEUE && YX5300_USE_FADE)
+/**
+ * @brief  Fade the volume to a level in a period of time
+ * @note   This function only starts the fade and returns. The volume commands
+ *         are sent by YX5300_Process, one after the ACK of the previous
+ *         command, with the volume of the elapsed fraction of Duration. So the
+ *         number of steps depends on the ACK round-trip time and a step that
+ *         would not change the volume is not sent.
+ * @note   The fade starts from the last step of the running fade. Otherwise it
+ *         starts when the queued commands are sent, from the last volume that
+ *         is sent to the module or confirmed by a volume reply. If that volume
+ *         is unknown (e.g. after init or reset, or a volume step from an unknown
+ *         level), the target is sent in one step. Call YX5300_QueryVolume before
+ *         to fade from the current volume. Volume commands of user stop the fade.
+ * @param  Handler: Pointer to handler
+ * @param  Volume: Target volume level (0-30)
+ * @param  Duration: Fade time in ms (0: the next step sets the target)
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_FadeTo(YX5300_Handler_t *Handler, uint8_t Volume, uint16_t Duration);
+#endif
+
+
+/**
+ * @brief  Play track by index
+ * @note   If YX5300_USE_CACHE is enabled and the module is known to be in the
+ *         requested state, the command is not sent.
+ * @param  Handler: Pointer to handler
+ * @param  Track: Track number
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_PlayTrack(YX5300_Handler_t *Handler, uint16_t Track);
+
+
+/**
+ * @brief  Play track by folder and file number
+ * @note   If YX5300_USE_CACHE is enabled and the module is known to be in the
+ *         requested state, the command is not sent.
+ * @param  Handler: Pointer to handler
+ * @param  Folder: Folder number
+ * @param  File: File number
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_PlayFolderFile(YX5300_Handler_t *Handler, uint8_t Folder, uint8_t File);
+
+
+/**
+ * @brief  Resume playback
+ * @note   If YX5300_USE_CACHE is enabled and the module is known to be in the
+ *         requested state, the command is not sent.
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_Resume(YX5300_Handler_t *Handler);
+
+
+/**
+ * @brief  Pause playback
+ * @note   If YX5300_USE_CACHE is enabled and the module is known to be in the
+ *         requested state, the command is not sent.
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_Pause(YX5300_Handler_t *Handler);
+
+
+/**
+ * @brief  Stop playback
+ * @note   If YX5300_USE_CACHE is enabled and the module is known to be in the
+ *         requested state, the command is not sent.
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_Stop(YX5300_Handler_t *Handler);
+
+
+/**
+ * @brief  Play track with a volume level in one command
+ * @note   If YX5300_USE_CACHE is enabled and the module is known to be in the
+ *         requested state, the command is not sent.
+ * @param  Handler: Pointer to handler
+ * @param  Track: Track number (1-255)
+ * @param  Volume: Volume level (0-30)
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_PlayWithVolume(YX5300_Handler_t *Handler, uint8_t Track, uint8_t Volume);
+
+
+/**
+ * @brief  Play all files of a folder repeatedly
+ * @param  Handler: Pointer to handler
+ * @param  Folder: Folder number
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_PlayFolderCycle(YX5300_Handler_t *Handler, uint8_t Folder);
+
+
+/**
+ * @brief  Play a track repeatedly
+ * @param  Handler: Pointer to handler
+ * @param  Track: Track number
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_PlayTrackCycle(YX5300_Handler_t *Handler, uint16_t Track);
+
+
+/**
+ * @brief  Enable or disable repeating the current track
+ * @param  Handler: Pointer to handler
+ * @param  Enable: 1 to repeat the current track, 0 to stop repeating
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_SetSingleCycle(YX5300_Handler_t *Handler, uint8_t Enable);
+
+
+/**
+ * @brief  Turn the DAC output on or off
+ * @param  Handler: Pointer to handler
+ * @param  Enable: 1 to turn the DAC on, 0 to turn it off
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_SetDAC(YX5300_Handler_t *Handler, uint8_t Enable);
+
+
+/**
+ * @brief  Put the module into sleep mode
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_Sleep(YX5300_Handler_t *Handler);
+
+
+/**
+ * @brief  Wake the module up from sleep mode
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send or receive data.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_WakeUp(YX5300_Handler_t *Handler);
+
+
+
+/**
+ ==================================================================================
+                           ##### Playlist Functions #####                          
+ ==================================================================================
+ */
+
+#if (YX5300_USE_PLAYLIST)
+/**
+ * @brief  Remove all items from the playlist and stop the playlist engine
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_PlaylistClear(YX5300_Handler_t *Handler);
+
+
+/**
+ * @brief  Add an item to the end of the playlist
+ * @param  Handler: Pointer to handler
+ * @param  Folder: Folder number (if 0, File is the track number)
+ * @param  File: File number in folder or track number (if 0 and Folder is not
+ *               0, all files of the folder are played repeatedly until
+ *               YX5300_PlaylistNext is called)
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Playlist is full.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_PlaylistAdd(YX5300_Handler_t *Handler, uint8_t Folder, uint16_t File);
+
+
+/**
+ * @brief  Add an item with its own volume level to the end of the playlist
+ * @note   The volume is set right before playing the item. For a track number
+ *         up to 255 the track and volume are sent in one command.
+ * @note   If YX5300_PLAYLIST_FADE_TIME is not 0 (and YX5300_USE_FADE is
+ *         enabled), the item is started silent and faded in to its volume.
+ * @param  Handler: Pointer to handler
+ * @param  Folder: Folder number (if 0, File is the track number)
+ * @param  File: File number in folder or track number (if 0 and Folder is not
+ *               0, all files of the folder are played repeatedly until
+ *               YX5300_PlaylistNext is called)
+ * @param  Volume: Volume level (1-30, 0 means keep the current volume)
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Playlist is full.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_PlaylistAddWithVolume(YX5300_Handler_t *Handler,
+                             uint8_t Folder, uint16_t File, uint8_t Volume);
+
+
+/**
+ * @brief  Set play mode of the playlist
+ * @param  Handler: Pointer to handler
+ * @param  Mode: Play mode
+ *         - YX5300_PLAYMODE_SEQUENTIAL: Play items in order and stop at the end.
+ *         - YX5300_PLAYMODE_REPEAT: Play items in order and repeat from first.
+ *         - YX5300_PLAYMODE_SHUFFLE: Play random items endlessly.
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_PlaylistSetMode(YX5300_Handler_t *Handler, YX5300_PlayMode_t Mode);
+
+
+/**
+ * @brief  Start playing the playlist from an item
+ * @note   The next item is requested as soon as the "completed play" (0x3D)
+ *         response of module is parsed. So the requests are sent from the
+ *         context that calls YX5300_Rx or YX5300_RxBuffer (if YX5300_USE_TX_QUEUE
+ *         is disabled).
+ * @param  Handler: Pointer to handler
+ * @param  Index: Index of the first item to play
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send data.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_PlaylistPlay(YX5300_Handler_t *Handler, uint8_t Index);
+
+
+/**
+ * @brief  Skip to the next item of the playlist
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send data or playlist is not active.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_PlaylistNext(YX5300_Handler_t *Handler);
+
+
+/**
+ * @brief  Stop the playlist engine and playback
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send data.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_PlaylistStop(YX5300_Handler_t *Handler);
+#endif
+
+
+/**
+ ==================================================================================
+                        ##### Media Library Functions #####                        
+ ==================================================================================
+ */
+
+#if (YX5300_USE_LIBRARY)
+/**
+ * @brief  Set the buffer of media library index
+ * @note   This function should be called before YX5300_Init, so the index is
+ *         built right after initialization.
+ * @param  Handler: Pointer to handler
+ * @param  Table: Buffer to store the number of files of each folder
+ * @param  Size: Number of entries in Table (maximum number of folders)
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_LibrarySetBuffer(YX5300_Handler_t *Handler, uint8_t *Table, uint8_t Size);
+
+
+/**
+ * @brief  Start building the media library index
+ * @note   The folders are queried one by one as soon as the response of the
+ *         previous query is parsed. The index is ready when Library.State of
+ *         handler is YX5300_LIBRARY_READY.
+ * @note   A query with no reply is sent again by YX5300_Process after
+ *         YX5300_LIBRARY_TIMEOUT ms (at most YX5300_LIBRARY_RETRIES times), then
+ *         the scan is stopped and Library.State becomes YX5300_LIBRARY_EMPTY.
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send data or buffer is not set.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_LibraryScan(YX5300_Handler_t *Handler);
+
+
+/**
+ * @brief  Find folder and file number of a track locally
+ * @note   Tracks are assumed to be numbered folder by folder (files of folder 01
+ *         first, then folder 02, ...), which is the case when the folders are
+ *         copied to the memory card in order.
+ * @param  Handler: Pointer to handler
+ * @param  Track: Track number (1 is the first file of the first folder)
+ * @param  Folder: Pointer to store the folder number
+ * @param  File: Pointer to store the file number
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Index is not ready or track is not found.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_LibraryGetTrack(YX5300_Handler_t *Handler, uint16_t Track,
+                       uint8_t *Folder, uint8_t *File);
+
+
+/**
+ * @brief  Write the media library index into a buffer
+ * @note   The snapshot contains the total number of tracks, so a loaded
+ *         snapshot is only used for the same memory card content.
+ * @param  Handler: Pointer to handler
+ * @param  Buffer: Buffer to store the snapshot
+ * @param  Size: Size of Buffer (YX5300_LIBRARY_SNAPSHOT_SIZE(Library.Size) is
+ *               enough for any index)
+ * @param  Len: Pointer to store the length of snapshot
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Index is not ready or Buffer is too small.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_LibrarySave(YX5300_Handler_t *Handler,
+                   uint8_t *Buffer, uint16_t Size, uint16_t *Len);
+
+
+/**
+ * @brief  Read the media library index from a snapshot
+ * @note   This function should be called before YX5300_Init (or before
+ *         YX5300_LibraryScan). Then the scan only queries the total number of
+ *         tracks, and if it matches the snapshot, the index is ready without
+ *         querying the folders.
+ * @param  Handler: Pointer to handler
+ * @param  Buffer: Snapshot written by YX5300_LibrarySave
+ * @param  Len: Length of snapshot
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Snapshot is not valid or does not fit the buffer.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_LibraryLoad(YX5300_Handler_t *Handler, const uint8_t *Buffer, uint16_t Len);
+#endif
+
+
+
+/**
+ ==================================================================================
+                             ##### Batch Functions #####                           
+ ==================================================================================
+ */
+
+#if (YX5300_USE_BATCH)
+/**
+ * @brief  Start recording a batch of commands
+ * @note   Media control commands that are called after this function are not
+ *         sent. They are encoded into the batch buffer until YX5300_EndBatch is
+ *         called. Status update and query functions must not be called meanwhile.
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Another batch is being recorded or is not sent yet.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_BeginBatch(YX5300_Handler_t *Handler);
+
+
+/**
+ * @brief  Send the recorded batch of commands
+ * @note   All frames are given to the platform in one Send call. Only the last
+ *         command is sent with feedback (if its feedback mode is enabled), so one
+ *         ACK confirms the whole batch.
+ * @note   If YX5300_USE_TX_QUEUE is enabled, the batch is queued as one entry and
+ *         sent by YX5300_Process. If the queue is full, the batch stays recorded
+ *         and this function can be called again later. If the platform layer
+ *         sends only a part of the batch, YX5300_Process sends the rest after
+ *         YX5300_BATCH_GAP and no other command is sent in between.
+ * @note   If YX5300_USE_TX_QUEUE is disabled and sending fails after some frames,
+ *         the rest of the batch is dropped, so no command is sent twice.
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: No batch is recorded or failed to send data.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ *         - YX5300_QUEUE_FULL: Tx queue is full.
+ */
+YX5300_Result_t
+YX5300_EndBatch(YX5300_Handler_t *Handler);
+#endif
+
+
+
+/**
+ ==================================================================================
+                        ##### Configuration Functions #####                        
+ ==================================================================================
+ */
+
+/**
+ * @brief  Set default feedback mode of commands
+ * @note   If feedback is enabled, module sends an ACK frame for each command.
+ * @param  Handler: Pointer to handler
+ * @param  Feedback: Feedback mode
+ *         - YX5300_FEEDBACK_DEFAULT: Same as YX5300_FEEDBACK_ENABLE
+ *         - YX5300_FEEDBACK_ENABLE: Module sends ACK for commands.
+ *         - YX5300_FEEDBACK_DISABLE: Module does not send ACK for commands.
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_SetFeedback(YX5300_Handler_t *Handler, YX5300_Feedback_t Feedback);
+
+
+/**
+ * @brief  Override feedback mode of the next command
+ * @note   The override is applied to the next command only. Then default
+ *         feedback mode of handler is used again.
+ * @param  Handler: Pointer to handler
+ * @param  Feedback: Feedback mode
+ *         - YX5300_FEEDBACK_DEFAULT: Use default feedback mode of handler.
+ *         - YX5300_FEEDBACK_ENABLE: Module sends ACK for next command.
+ *         - YX5300_FEEDBACK_DISABLE: Module does not send ACK for next command.
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_SetNextFeedback(YX5300_Handler_t *Handler, YX5300_Feedback_t Feedback);
+
+
+#if (YX5300_USE_EVENTS)
+/**
+ * @brief  Set event callback function
+ * @note   The callback is called from the context that calls YX5300_Rx or
+ *         YX5300_RxBuffer, right after a response frame is parsed.
+ * @param  Handler: Pointer to handler
+ * @param  Callback: Pointer to callback function (NULL to disable events)
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_SetEventCallback(YX5300_Handler_t *Handler,
+                        YX5300_EventCallback_t Callback);
+#endif
+
+
+#if (YX5300_USE_TX_QUEUE)
+/**
+ * @brief  Set ACK timeout of queued commands for this handler
+ * @param  Handler: Pointer to handler
+ * @note   If YX5300_USE_TX_RETRY is enabled, this is the upper bound of the
+ *         adaptive ACK timeout.
+ * @param  Timeout: ACK timeout in ms (0: YX5300_TX_ACK_TIMEOUT)
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_SetAckTimeout(YX5300_Handler_t *Handler, uint16_t Timeout);
+#endif
+
+
+#if (YX5300_USE_TX_QUEUE && YX5300_USE_TX_PRIORITY)
+/**
+ * @brief  Put the next command into the urgent lane of Tx queue
+ * @note   Urgent commands are sent before the commands of the normal lane, right
+ *         after the command that is being sent gets its ACK or timeout.
+ *         YX5300_Stop and YX5300_Pause are always urgent.
+ * @param  Handler: Pointer to handler
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_SetNextUrgent(YX5300_Handler_t *Handler);
+#endif
+
+
+
+/**
+ ==================================================================================
+                             ##### Group Functions #####                           
+ ==================================================================================
+ */
+
+#if (YX5300_USE_GROUP)
+/**
+ * @brief  Initialize a group of handlers
+ * @note   Handlers must be initialized by YX5300_Init separately.
+ * @param  Group: Pointer to group
+ * @param  Handlers: Pointer to array of handlers
+ * @param  Count: Number of handlers in array
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_GroupInit(YX5300_Group_t *Group,
+                 YX5300_Handler_t *Handlers, uint8_t Count);
+
+
+/**
+ * @brief  Process all handlers of a group
+ * @note   For each handler, the received data is read by Receive function of
+ *         platform (if linked) and parsed, then YX5300_Process is called. Each
+ *         handler gets at most one transmit slot per call and the handler that
+ *         is served first is changed on each call (round-robin).
+ * @param  Group: Pointer to group
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Failed to send data for at least one handler.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_GroupProcess(YX5300_Group_t *Group);
+#endif
+
+
+#if (YX5300_USE_CODEC_API)
+/**
+ ==================================================================================
+                         ##### Frame Codec Functions #####                         
+ ==================================================================================
+ */
+
+/**
+ * @brief  Encode a batch of frames into one buffer
+ * @note   This function only uses its parameters, so it is reentrant and can be
+ *         called from ISR.
+ * @param  Frames: Pointer to array of frames
+ * @param  Count: Number of frames
+ * @param  Checksum: 1 for frames with checksum, 0 for frames without it
+ * @param  Buffer: Pointer to output buffer
+ * @param  Size: Size of output buffer
+ * @param  Len: Pointer to store the number of written bytes
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_FAIL: Buffer is too small (nothing is written).
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_EncodeFrame(const YX5300_Frame_t *Frames, uint8_t Count, uint8_t Checksum,
+                   uint8_t *Buffer, uint16_t Size, uint16_t *Len);
+
+
+/**
+ * @brief  Initialize a frame decoder
+ * @param  Decoder: Pointer to decoder state
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: Operation was successful.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_DecoderInit(YX5300_Decoder_t *Decoder);
+
+
+/**
+ * @brief  Decode a stream of received bytes
+ * @note   Parsing stops right after the first complete or dropped frame. If
+ *         Consumed is less than Len, user should call this function again with
+ *         the rest of the data. Frames without checksum are accepted only if
+ *         YX5300_RX_SHORT_FRAMES is enabled.
+ * @note   This function only uses its parameters (the decoder state is given by
+ *         user), so it is reentrant and can be called from ISR. It does not
+ *         change any handler.
+ * @param  Decoder: Pointer to decoder state initialized by YX5300_DecoderInit
+ * @param  Data: Pointer to received data
+ * @param  Len: Number of received bytes
+ * @param  Consumed: Pointer to store the number of parsed bytes (can be NULL)
+ * @param  Frame: Pointer to store the decoded frame
+ * @retval YX5300_Result_t
+ *         - YX5300_OK: All bytes parsed and no frame completed.
+ *         - YX5300_FAIL: A broken frame is dropped.
+ *         - YX5300_RX_COMPLETE: A frame is decoded into Frame.
+ *         - YX5300_INVALID_PARAM: Invalid parameter.
+ */
+YX5300_Result_t
+YX5300_DecodeFrame(YX5300_Decoder_t *Decoder,
+                   const uint8_t *Data, uint16_t Len, uint16_t *Consumed,
+                   YX5300_Frame_t *Frame);
+#endif
 
 
 
@@ -0,0 +1,680 @@
+/**
+ **********************************************************************************
+ * @file   YX5300.hpp
+ * @author Hossein.M (https://github.com/Hossein-M98)
+ * @brief  Header-only C++17 interface of YX5300 driver with a statically
+ *         dispatched platform
+ **********************************************************************************
+ *
+ * Copyright (c) 2024 Mahda Embedded System (MIT License)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ **********************************************************************************
+ */
+
+
+/* Define to prevent recursive inclusion ----------------------------------------*/
+#ifndef _YX5300_HPP_
+#define _YX5300_HPP_
+
+
+/* Includes ---------------------------------------------------------------------*/
+#include "YX5300.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+
+namespace yx5300
+{
+
+/**
+ * @brief  Player of one YX5300 module
+ * @note   It uses the same frame encoder and decoder as YX5300.c
+ *         (YX5300_codec.h), but it does not need YX5300.c. The platform is a
+ *         policy type, so its functions are called directly and can be inlined.
+ *         It must provide these static functions:
+ *         - bool send(const uint8_t *Data, uint8_t Len): Send data to module
+ *           and return true on success.
+ *         - void delay(uint16_t Time): Delay in ms.
+ *         - uint32_t now(): Time in ms (only used if QueueSize or
+ *           PlaylistSize is not 0).
+ * @note   Commands without data are sent from frames that are built at compile
+ *         time. No heap is used, the queue and the playlist are members.
+ * @note   The received data must be passed to Rx. Functions of a player must
+ *         not be called from several contexts at the same time, except Rx
+ *         during Init if YX5300_USE_FAST_INIT is enabled.
+ * @note   Commands have the same parameters and checks as the functions of
+ *         YX5300.h with the same name. The cache, coalescing, retry, urgent
+ *         lane, batch, fade, events and blocking queries of YX5300.c are not
+ *         included (Update* functions only send the query).
+ * @param  Platform: Platform policy type
+ * @param  QueueSize: Number of commands in Tx queue (0: Commands are sent
+ *         immediately)
+ * @param  PlaylistSize: Number of items in playlist (0: No playlist)
+ * @param  Checksum: true for frames with checksum, false for frames without it
+ */
+template <typename Platform,
+          uint8_t QueueSize = 0,
+          uint8_t PlaylistSize = 0,
+          bool Checksum = (YX5300_USE_CHECKSUM != 0)>
+class Player
+{
+public:
+  static constexpr uint8_t FrameSize =
+    Checksum ? YX5300_FRAME_SIZE_LONG : YX5300_FRAME_SIZE_SHORT;
+
+  /**
+   * @brief  Reset the module and select the memory card
+   * @note   If YX5300_USE_FAST_INIT is disabled, fixed delays
+   *         (YX5300_INIT_TIMEOUT) are used for each step. Otherwise each step
+   *         waits for the response of module (up to YX5300_INIT_TIMEOUT), so Rx
+   *         must be called from another context (e.g. UART interrupt) meanwhile.
+   * @retval YX5300_Result_t
+   *         - YX5300_OK: Operation was successful.
+   *         - YX5300_FAIL: Failed to send data, or the module reported an error
+   *                        for the device selection (no memory card).
+   *         - YX5300_TIMEOUT: The module did not answer the device selection
+   *                           (only if YX5300_USE_FAST_INIT is enabled).
+   */
+  YX5300_Result_t
+  Init()
+  {
+    Decoder_ = YX5300_Decoder_t{};
+    if constexpr (QueueSize != 0)
+    {
+      Head_ = 0;
+      Tail_ = 0;
+      Count_ = 0;
+      WaitAck_ = 0;
+    }
+
+    if constexpr (YX5300_USE_FAST_INIT != 0)
+    {
+      // The module may ignore the first reset command if it is not ready yet,
+      // so it is sent once more at the time the fixed delay used to expire
+      YX5300_Result_t Result = InitCommand(YX5300_CMD_RESET, 0, 0x3F, 0x3A);
+      if (Result == YX5300_TIMEOUT)
+        Result = InitCommand(YX5300_CMD_RESET, 0, 0x3F, 0x3A);
+      if (Result == YX5300_FAIL)
+        return YX5300_FAIL;
+
+      // The module reports an error if there is no memory card
+      Result = InitCommand(YX5300_CMD_SEL_DEV, 2, 0x41, 0x40);
+      if (Result == YX5300_OK && WaitReceived_ == 0x40)
+        return YX5300_FAIL;
+      return Result;
+    }
+
+    Platform::delay(YX5300_INIT_TIMEOUT);
+    if (Transmit<YX5300_CMD_RESET>(YX5300_CMD_FEEDBACK) != YX5300_OK)
+      return YX5300_FAIL;
+    Platform::delay(YX5300_INIT_TIMEOUT);
+
+    if (Transmit(YX5300_CMD_SEL_DEV, YX5300_CMD_FEEDBACK, 0, 2) != YX5300_OK)
+      return YX5300_FAIL;
+    Platform::delay(YX5300_INIT_TIMEOUT);
+
+    return YX5300_OK;
+  }
+
+  /**
+   * @brief  Pass a received byte to the player
+   * @note   Frames without checksum are accepted only if Checksum is false.
+   * @retval YX5300_Result_t
+   *         - YX5300_OK: Frame is not completed yet.
+   *         - YX5300_FAIL: Broken frame or unrecognized response.
+   *         - YX5300_RX_COMPLETE: Frame received successfully and status updated.
+   */
+  YX5300_Result_t
+  Rx(uint8_t Data)
+  {
+    switch (YX5300_CodecDecode(&Decoder_, Data, !Checksum))
+    {
+    case YX5300_DECODE_FRAME:
+      return ParseResponse();
+
+    case YX5300_DECODE_DROP:
+      return YX5300_FAIL;
+
+    default:
+      return YX5300_OK;
+    }
+  }
+
+  /**
+   * @brief  Send the next queued command (if QueueSize is not 0)
+   * @note   The next command is sent after the ACK of the previous one is
+   *         received or YX5300_TX_ACK_TIMEOUT is expired.
+   * @retval YX5300_Result_t
+   *         - YX5300_OK: Operation was successful.
+   *         - YX5300_FAIL: Failed to send data.
+   */
+  YX5300_Result_t
+  Process()
+  {
+    if constexpr (QueueSize != 0)
+    {
+      uint32_t Tick = Platform::now();
+
+      if (WaitAck_ && (uint32_t)(Tick - SendTick_) < Timeout_)
+        return YX5300_OK;
+      WaitAck_ = 0;
+
+      if (Count_ == 0)
+        return YX5300_OK;
+
+      const Command &Item = Queue_[Tail_];
+      if (Transmit(Item.Code, Item.Feedback, Item.Data1, Item.Data2) != YX5300_OK)
+        return YX5300_FAIL;
+
+      // There is no ACK for commands without feedback, but the module still
+      // needs a gap before the next command (WaitAck_ is 2)
+      Timeout_ = YX5300_TX_NO_ACK_GAP;
+      WaitAck_ = 2;
+      if (Item.Feedback == YX5300_CMD_FEEDBACK)
+      {
+        Timeout_ = YX5300_TX_ACK_TIMEOUT;
+        WaitAck_ = 1;
+      }
+      SendTick_ = Tick;
+      Tail_ = (uint8_t)((Tail_ + 1) % QueueSize);
+      Count_--;
+    }
+
+    return YX5300_OK;
+  }
+
+  /**
+   * @brief  Status of module updated by the received responses
+   */
+  const YX5300_Status_t &
+  Status() const
+  {
+    return Status_;
+  }
+
+  /**
+   * @brief  Enable or disable the feedback (ACK) of next commands
+   */
+  void
+  SetFeedback(bool Enable)
+  {
+    Feedback_ = Enable ? YX5300_CMD_FEEDBACK : YX5300_CMD_NOT_FEEDBACK;
+  }
+
+  /**
+   * @brief  Media functions (same parameters as the functions of YX5300.h with
+   *         the same name, the volume is limited to 30)
+   * @retval YX5300_Result_t
+   *         - YX5300_OK: Operation was successful.
+   *         - YX5300_FAIL: Failed to send data.
+   *         - YX5300_QUEUE_FULL: Tx queue is full.
+   */
+  YX5300_Result_t PlayNext()    { return Send<YX5300_CMD_NEXT>(); }
+  YX5300_Result_t PlayPrev()    { return Send<YX5300_CMD_PREV>(); }
+  YX5300_Result_t VolumeUp()    { return Send<YX5300_CMD_VOL_UP>(); }
+  YX5300_Result_t VolumeDown()  { return Send<YX5300_CMD_VOL_DOWN>(); }
+  YX5300_Result_t Resume()      { return Send<YX5300_CMD_PLAY>(); }
+  YX5300_Result_t Pause()       { return Send<YX5300_CMD_PAUSE>(); }
+  YX5300_Result_t Stop()        { return Send<YX5300_CMD_STOP>(); }
+  YX5300_Result_t Sleep()       { return Send<YX5300_CMD_SLEEP_MODE>(); }
+  YX5300_Result_t WakeUp()      { return Send<YX5300_CMD_WAKE_UP>(); }
+  YX5300_Result_t UpdateStatus() { return Send<YX5300_CMD_QUERY_STATUS>(); }
+  YX5300_Result_t UpdateVolume() { return Send<YX5300_CMD_QUERY_VOLUME>(); }
+  YX5300_Result_t UpdateTrack()  { return Send<YX5300_CMD_PLAYING_N>(); }
+
+  YX5300_Result_t
+  SetVolume(uint8_t Volume)
+  {
+    if (Volume > 30)
+      Volume = 30;
+    return Send(YX5300_CMD_VOL_SET, 0, Volume);
+  }
+
+  YX5300_Result_t
+  PlayTrack(uint16_t Track)
+  {
+    return Send(YX5300_CMD_PLAY_INDEX, (uint8_t)(Track >> 8), (uint8_t)Track);
+  }
+
+  YX5300_Result_t
+  PlayFolderFile(uint8_t Folder, uint8_t File)
+  {
+    return Send(YX5300_CMD_PLAY_FOLD_FILE, Folder, File);
+  }
+
+  YX5300_Result_t
+  PlayFolderCycle(uint8_t Folder)
+  {
+    return Send(YX5300_CMD_PLAY_CYCLE_FOLD, Folder, 0);
+  }
+
+  /**
+   * @brief  Playlist functions (if PlaylistSize is not 0, same parameters and
+   *         results as the functions of YX5300.h with the same name)
+   * @note   The volume of an item is set by a command, it is never faded in
+   *         (YX5300_PLAYLIST_FADE_TIME is not used).
+   */
+  void
+  PlaylistClear()
+  {
+    static_assert(PlaylistSize != 0, "PlaylistSize is 0");
+    Playlist_.Count = 0;
+    Playlist_.Index = 0;
+    Playlist_.Active = false;
+  }
+
+  YX5300_Result_t
+  PlaylistAdd(uint8_t Folder, uint16_t File)
+  {
+    return PlaylistAddWithVolume(Folder, File, 0);
+  }
+
+  YX5300_Result_t
+  PlaylistAddWithVolume(uint8_t Folder, uint16_t File, uint8_t Volume)
+  {
+    static_assert(PlaylistSize != 0, "PlaylistSize is 0");
+    if ((Folder != 0 && File > 0xFF) || (Folder == 0 && File == 0))
+      return YX5300_INVALID_PARAM;
+    if (Playlist_.Count >= PlaylistSize)
+      return YX5300_FAIL;
+
+    if (Volume > 30)
+      Volume = 30;
+
+    Playlist_.Items[Playlist_.Count].Folder = Folder;
+    Playlist_.Items[Playlist_.Count].Volume = Volume;
+    Playlist_.Items[Playlist_.Count].File = File;
+    Playlist_.Count++;
+    return YX5300_OK;
+  }
+
+  void
+  PlaylistSetMode(YX5300_PlayMode_t Mode)
+  {
+    static_assert(PlaylistSize != 0, "PlaylistSize is 0");
+    Playlist_.Mode = Mode;
+  }
+
+  YX5300_Result_t
+  PlaylistPlay(uint8_t Index)
+  {
+    static_assert(PlaylistSize != 0, "PlaylistSize is 0");
+    if (Index >= Playlist_.Count)
+      return YX5300_INVALID_PARAM;
+
+    Playlist_.Index = Index;
+    Playlist_.Active = true;
+    Playlist_.Pending = false;
+    return PlaylistPlayItem();
+  }
+
+  YX5300_Result_t
+  PlaylistNext()
+  {
+    static_assert(PlaylistSize != 0, "PlaylistSize is 0");
+    if (!Playlist_.Active)
+      return YX5300_FAIL;
+    return PlaylistAdvance();
+  }
+
+  YX5300_Result_t
+  PlaylistStop()
+  {
+    static_assert(PlaylistSize != 0, "PlaylistSize is 0");
+    Playlist_.Active = false;
+    return Stop();
+  }
+
+private:
+  struct Command
+  {
+    uint8_t Code;
+    uint8_t Feedback;
+    uint8_t Data1;
+    uint8_t Data2;
+  };
+
+  struct PlaylistItem
+  {
+    uint8_t  Folder;  // if 0, File is the track number
+    uint8_t  Volume;  // if 0, volume is not changed
+    uint16_t File;    // if 0 (and Folder is not 0), the folder is repeated
+  };
+
+  struct PlaylistState
+  {
+    std::array<PlaylistItem, PlaylistSize> Items{};
+    uint8_t  Count = 0;
+    uint8_t  Index = 0;
+    YX5300_PlayMode_t Mode = YX5300_PLAYMODE_SEQUENTIAL;
+    bool     Active = false;
+    bool     Pending = false;  // A play command is sent and its completion is waited
+    uint32_t PlayTick = 0;     // Time of the last play command
+    uint32_t Seed = 0x12345678;
+  };
+
+  struct Empty
+  {
+  };
+
+  // Minimum play time of a playlist item in ms (the doubled "completed play"
+  // response comes earlier)
+  static constexpr uint32_t PlaylistMinTrack = 500;
+
+  template <uint8_t Code, uint8_t Feedback>
+  static constexpr std::array<uint8_t, FrameSize>
+  ConstFrame()
+  {
+    if constexpr (Checksum)
+      return std::array<uint8_t, FrameSize> YX5300_FRAME_LONG(Code, Feedback, 0, 0);
+    else
+      return std::array<uint8_t, FrameSize> YX5300_FRAME_SHORT(Code, Feedback, 0, 0);
+  }
+
+  template <uint8_t Code>
+  YX5300_Result_t
+  Transmit(uint8_t Feedback)
+  {
+    static constexpr std::array<uint8_t, FrameSize> Frames[2] =
+      {ConstFrame<Code, YX5300_CMD_NOT_FEEDBACK>(), ConstFrame<Code, YX5300_CMD_FEEDBACK>()};
+
+    if (!Platform::send(Frames[Feedback].data(), FrameSize))
+      return YX5300_FAIL;
+
+    Status_.LastCommand = Code;
+    Status_.LastCommandData = 0;
+    return YX5300_OK;
+  }
+
+  YX5300_Result_t
+  Transmit(uint8_t Code, uint8_t Feedback, uint8_t Data1, uint8_t Data2)
+  {
+    uint8_t Frame[FrameSize];
+
+    YX5300_CodecEncode(Frame, Code, Feedback, Data1, Data2, Checksum);
+    if (!Platform::send(Frame, FrameSize))
+      return YX5300_FAIL;
+
+    Status_.LastCommand = Code;
+    Status_.LastCommandData = (uint16_t)((Data1 << 8) | Data2);
+    return YX5300_OK;
+  }
+
+  template <uint8_t Code>
+  YX5300_Result_t
+  Send()
+  {
+    if constexpr (QueueSize != 0)
+      return Enqueue(Code, 0, 0);
+    else
+      return Transmit<Code>(Feedback_);
+  }
+
+  YX5300_Result_t
+  Send(uint8_t Code, uint8_t Data1, uint8_t Data2)
+  {
+    if constexpr (QueueSize != 0)
+      return Enqueue(Code, Data1, Data2);
+    else
+      return Transmit(Code, Feedback_, Data1, Data2);
+  }
+
+  YX5300_Result_t
+  Enqueue(uint8_t Code, uint8_t Data1, uint8_t Data2)
+  {
+    if constexpr (QueueSize != 0)
+    {
+      if (Count_ >= QueueSize)
+        return YX5300_QUEUE_FULL;
+
+      Queue_[Head_] = Command{Code, Feedback_, Data1, Data2};
+      Head_ = (uint8_t)((Head_ + 1) % QueueSize);
+      Count_++;
+    }
+    return YX5300_OK;
+  }
+
+  YX5300_Result_t
+  InitCommand(uint8_t Code, uint8_t Data2, uint8_t Code1, uint8_t Code2)
+  {
+    WaitReceived_ = 0;
+    WaitCode_[0] = Code1;
+    WaitCode_[1] = Code2;
+
+    YX5300_Result_t Result = Transmit(Code, YX5300_CMD_FEEDBACK, 0, Data2);
+    if (Result == YX5300_OK)
+    {
+      // The time is counted by the delays, so now() is not needed
+      Result = YX5300_TIMEOUT;
+      for (uint16_t Elapsed = 0; Elapsed < YX5300_INIT_TIMEOUT; Elapsed++)
+      {
+        if (WaitReceived_)
+        {
+          Result = YX5300_OK;
+          break;
+        }
+        Platform::delay(1);
+      }
+    }
+
+    WaitCode_[0] = 0;
+    WaitCode_[1] = 0;
+    return Result;
+  }
+
+  YX5300_Result_t
+  ParseResponse()
+  {
+    Status_.LastResponse = Decoder_.Buffer[3];
+    Status_.LastResponseData = (uint16_t)((Decoder_.Buffer[5] << 8) | Decoder_.Buffer[6]);
+
+    switch (Status_.LastResponse)
+    {
+    case 0x3A: // Memory card inserted
+      Status_.MemoryInserted = 1;
+      break;
+
+    case 0x3B: // Memory card removed
+      Status_.MemoryInserted = 0;
+      break;
+
+    case 0x3D: // Completed play num 'DAT'
+      Status_.Track = 0;
+      break;
+
+    case 0x3F: // Initialization done, online devices 'DAT'
+      Status_.MemoryInserted = (Status_.LastResponseData & 0x02) ? 1 : 0;
+      break;
+
+    case 0x40: // Error
+    case 0x41: // Data received correctly
+      // An unsolicited response must not end the gap of a command without
+      // feedback
+      if constexpr (QueueSize != 0)
+        if (WaitAck_ == 1)
+          WaitAck_ = 0;
+      break;
+
+    case 0x42: // Status 'DAT'
+      Status_.StatusByte = (uint8_t)Status_.LastResponseData;
+      if (Status_.StatusByte == 0x00)
+        Status_.Track = 0;
+      break;
+
+    case 0x43: // Vol playing 'DAT'
+      Status_.Volume = (uint8_t)Status_.LastResponseData;
+      break;
+
+    case 0x48: // File count 'DAT'
+      Status_.TotalTracks = Status_.LastResponseData;
+      break;
+
+    case 0x4C: // Playing track 'DAT'
+      Status_.Track = Status_.LastResponseData;
+      break;
+
+    case 0x4E: // Folder file count 'DAT'
+    case 0x4F: // Folder count 'DAT'
+      break;
+
+    default: // Unrecognized response
+      return YX5300_FAIL;
+    }
+
+    if (Status_.LastResponse == WaitCode_[0] || Status_.LastResponse == WaitCode_[1])
+      WaitReceived_ = Status_.LastResponse;
+
+    if constexpr (PlaylistSize != 0)
+      PlaylistOnResponse();
+
+    return YX5300_RX_COMPLETE;
+  }
+
+  YX5300_Result_t
+  PlaylistPlayItem()
+  {
+    YX5300_Result_t Result = PlaylistSendItem();
+
+    // One completion is taken for each play command
+    if (Result == YX5300_OK)
+    {
+      Playlist_.Pending = true;
+      Playlist_.PlayTick = Platform::now();
+    }
+    return Result;
+  }
+
+  YX5300_Result_t
+  PlaylistSendItem()
+  {
+    const PlaylistItem &Item = Playlist_.Items[Playlist_.Index];
+
+    // Track and volume are sent in one frame if it is possible
+    if (Item.Volume != 0 && Item.Folder == 0 && Item.File <= 0xFF)
+      return Send(YX5300_CMD_PLAY_WITH_VOL, Item.Volume, (uint8_t)Item.File);
+
+    if (Item.Volume != 0)
+    {
+      YX5300_Result_t Result = Send(YX5300_CMD_VOL_SET, 0, Item.Volume);
+      if (Result != YX5300_OK)
+        return Result;
+    }
+
+    if (Item.Folder == 0)
+      return Send(YX5300_CMD_PLAY_INDEX, (uint8_t)(Item.File >> 8), (uint8_t)Item.File);
+
+    // The module repeats the folder itself
+    if (Item.File == 0)
+      return Send(YX5300_CMD_PLAY_CYCLE_FOLD, Item.Folder, 0);
+
+    return Send(YX5300_CMD_PLAY_FOLD_FILE, Item.Folder, (uint8_t)Item.File);
+  }
+
+  YX5300_Result_t
+  PlaylistAdvance()
+  {
+    uint8_t Index = Playlist_.Index;
+    uint32_t x = 0;
+
+    switch (Playlist_.Mode)
+    {
+    case YX5300_PLAYMODE_SHUFFLE:
+      while (Playlist_.Count > 1 && Index == Playlist_.Index)
+      {
+        // xorshift32
+        x = Playlist_.Seed;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        Playlist_.Seed = x;
+        Index = (uint8_t)(x % Playlist_.Count);
+      }
+      break;
+
+    case YX5300_PLAYMODE_REPEAT:
+      Index = (uint8_t)((Index + 1) % Playlist_.Count);
+      break;
+
+    default:
+      Index++;
+      if (Index >= Playlist_.Count)
+      {
+        Playlist_.Active = false;
+        return YX5300_OK;
+      }
+      break;
+    }
+
+    Playlist_.Index = Index;
+    return PlaylistPlayItem();
+  }
+
+  void
+  PlaylistOnResponse()
+  {
+    if (Status_.LastResponse != 0x3D)
+      return;
+
+    // Module may send the "completed play" response twice back-to-back. Only
+    // the first completion after a play command is taken, and a completion
+    // that comes right after the play command belongs to the previous item.
+    if (!Playlist_.Pending ||
+        (uint32_t)(Platform::now() - Playlist_.PlayTick) < PlaylistMinTrack)
+      return;
+    Playlist_.Pending = false;
+
+    if (!Playlist_.Active)
+      return;
+
+    // A repeated folder is played until PlaylistNext is called
+    if (Playlist_.Items[Playlist_.Index].Folder != 0 &&
+        Playlist_.Items[Playlist_.Index].File == 0)
+      return;
+
+    PlaylistAdvance();
+  }
+
+  YX5300_Decoder_t Decoder_{};
+  YX5300_Status_t Status_{};
+  uint8_t Feedback_ = YX5300_CMD_FEEDBACK;
+
+  // Response that Init waits for
+  uint8_t WaitCode_[2] = {0, 0};
+  volatile uint8_t WaitReceived_ = 0; // Received code (0: none)
+
+  // Tx queue
+  std::array<Command, QueueSize> Queue_{};
+  uint8_t  Head_ = 0;
+  uint8_t  Tail_ = 0;
+  uint8_t  Count_ = 0;
+  uint8_t  WaitAck_ = 0;  // 1: ACK, 2: gap of a command without feedback
+  uint16_t Timeout_ = 0;
+  uint32_t SendTick_ = 0;
+
+  // Playlist
+  std::conditional_t<(PlaylistSize != 0), PlaylistState, Empty> Playlist_{};
+};
+
+} // namespace yx5300
+
+#endif //! _YX5300_HPP_
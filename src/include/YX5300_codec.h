@@ -0,0 +1,348 @@
+/**
+ **********************************************************************************
+ * @file   YX5300_codec.h
+ * @author Hossein.M (https://github.com/Hossein-M98)
+ * @brief  Frame encoder and decoder of YX5300 protocol (shared by YX5300.c and
+ *         YX5300.hpp)
+ **********************************************************************************
+ *
+ * Copyright (c) 2024 Mahda Embedded System (MIT License)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ **********************************************************************************
+ */
+
+
+/* Define to prevent recursive inclusion ----------------------------------------*/
+#ifndef _YX5300_CODEC_H_
+#define _YX5300_CODEC_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Includes ---------------------------------------------------------------------*/
+#include <stdint.h>
+
+
+/* Exported Constants -----------------------------------------------------------*/
+/**
+ * @brief  Command bytes for the YX5300 MP3 module
+ */
+#define YX5300_CMD_START_BYTE       0x7E
+#define YX5300_CMD_VERSION          0xFF
+#define YX5300_CMD_NOT_FEEDBACK     0x00
+#define YX5300_CMD_FEEDBACK         0x01
+#define YX5300_CMD_END_BYTE         0xEF
+
+/**
+ * @brief  Number of bytes from version byte to the end of data bytes
+ */
+#define YX5300_FRAME_LEN            0x06
+
+/**
+ * @brief  Size of frames without and with checksum
+ */
+#define YX5300_FRAME_SIZE_SHORT     8
+#define YX5300_FRAME_SIZE_LONG      10
+
+/**
+ * @brief  Commands for the YX5300 MP3 module
+ */
+#define YX5300_CMD_NEXT               0x01
+#define YX5300_CMD_PREV               0x02
+#define YX5300_CMD_PLAY_INDEX         0x03
+#define YX5300_CMD_VOL_UP             0x04
+#define YX5300_CMD_VOL_DOWN           0x05
+#define YX5300_CMD_VOL_SET            0x06
+#define YX5300_CMD_SINGLE_CYCLE       0x08
+#define YX5300_CMD_SEL_DEV            0x09
+#define YX5300_CMD_SLEEP_MODE         0x0A
+#define YX5300_CMD_WAKE_UP            0x0B
+#define YX5300_CMD_RESET              0x0C
+#define YX5300_CMD_PLAY               0x0D
+#define YX5300_CMD_PAUSE              0x0E
+#define YX5300_CMD_PLAY_FOLD_FILE     0x0F
+#define YX5300_CMD_STOP               0x16
+#define YX5300_CMD_PLAY_CYCLE_FOLD    0x17
+#define YX5300_CMD_SET_SNGL_CYCL      0x19
+#define YX5300_CMD_SET_DAC            0x1A
+#define YX5300_CMD_PLAY_WITH_VOL      0x22
+#define YX5300_CMD_QUERY_STATUS       0x42
+#define YX5300_CMD_QUERY_VOLUME       0x43
+#define YX5300_CMD_QUERY_TOT_TRACKS   0x48
+#define YX5300_CMD_PLAYING_N          0x4C
+#define YX5300_CMD_QUERY_FLDR_TRACKS  0x4E
+#define YX5300_CMD_QUERY_FLDR_COUNT   0x4F
+
+
+/* Exported Macros --------------------------------------------------------------*/
+/**
+ * @brief  Checksum of a frame as a constant expression
+ */
+#define YX5300_FRAME_CHECKSUM(CMD, FBK, DATA1, DATA2)                        \
+  ((uint16_t)(0x10000 - (YX5300_CMD_VERSION + YX5300_FRAME_LEN +             \
+                         (CMD) + (FBK) + (DATA1) + (DATA2))))
+
+/**
+ * @brief  Initializer of a frame without checksum (8 bytes)
+ */
+#define YX5300_FRAME_SHORT(CMD, FBK, DATA1, DATA2)                           \
+  {YX5300_CMD_START_BYTE, YX5300_CMD_VERSION, YX5300_FRAME_LEN,              \
+   (uint8_t)(CMD), (uint8_t)(FBK), (uint8_t)(DATA1), (uint8_t)(DATA2),       \
+   YX5300_CMD_END_BYTE}
+
+/**
+ * @brief  Initializer of a frame with checksum (10 bytes)
+ */
+#define YX5300_FRAME_LONG(CMD, FBK, DATA1, DATA2)                            \
+  {YX5300_CMD_START_BYTE, YX5300_CMD_VERSION, YX5300_FRAME_LEN,              \
+   (uint8_t)(CMD), (uint8_t)(FBK), (uint8_t)(DATA1), (uint8_t)(DATA2),       \
+   (uint8_t)(YX5300_FRAME_CHECKSUM(CMD, FBK, DATA1, DATA2) >> 8),            \
+   (uint8_t)(YX5300_FRAME_CHECKSUM(CMD, FBK, DATA1, DATA2) & 0xFF),          \
+   YX5300_CMD_END_BYTE}
+
+
+
+/* Exported Data Types ----------------------------------------------------------*/
+/**
+ * @brief  Fields of a command or response frame
+ */
+typedef struct YX5300_Frame_s
+{
+  uint8_t  Command;   // Command or response code
+  uint8_t  Feedback;  // YX5300_CMD_FEEDBACK or YX5300_CMD_NOT_FEEDBACK
+  uint16_t Data;      // Data1 (high byte) and Data2 (low byte)
+} YX5300_Frame_t;
+
+
+/**
+ * @brief  State of frame decoder
+ */
+typedef struct YX5300_Decoder_s
+{
+  uint8_t Buffer[YX5300_FRAME_SIZE_LONG];
+  uint8_t BufferIndex;
+  uint8_t InFrame;
+} YX5300_Decoder_t;
+
+
+/**
+ * @brief  Result of decoding a byte
+ */
+typedef enum YX5300_Decode_e
+{
+  YX5300_DECODE_PENDING  = 0, // Frame is not completed yet
+  YX5300_DECODE_FRAME    = 1, // A frame is completed in Buffer
+  YX5300_DECODE_DROP     = 2, // A broken frame is dropped
+} YX5300_Decode_t;
+
+
+
+/**
+ ==================================================================================
+                               ##### Functions #####
+ ==================================================================================
+ */
+
+/**
+ * @brief  Calculate checksum of a frame
+ * @param  Frame: Pointer to frame (at least 7 bytes)
+ * @retval Checksum
+ */
+static inline uint16_t
+YX5300_CodecChecksum(const uint8_t *Frame)
+{
+  uint16_t Sum = 0;
+  uint8_t i = 0;
+
+  for (i = 1; i <= YX5300_FRAME_LEN; i++)
+    Sum += Frame[i];
+
+  return (uint16_t)(0 - Sum);
+}
+
+
+/**
+ * @brief  Build a command frame
+ * @param  Frame: Pointer to buffer (YX5300_FRAME_SIZE_LONG bytes if Checksum is
+ *                1, else YX5300_FRAME_SIZE_SHORT bytes)
+ * @param  Command: Command code
+ * @param  Feedback: YX5300_CMD_FEEDBACK or YX5300_CMD_NOT_FEEDBACK
+ * @param  Data1: Data1 or high byte of the data
+ * @param  Data2: Data2 or low byte of the data
+ * @param  Checksum: 1 for a frame with checksum, 0 for a frame without it
+ * @retval Size of frame
+ */
+static inline uint8_t
+YX5300_CodecEncode(uint8_t *Frame, uint8_t Command, uint8_t Feedback,
+                   uint8_t Data1, uint8_t Data2, uint8_t Checksum)
+{
+  uint16_t Sum = 0;
+
+  Frame[0] = YX5300_CMD_START_BYTE;
+  Frame[1] = YX5300_CMD_VERSION;
+  Frame[2] = YX5300_FRAME_LEN;
+  Frame[3] = Command;
+  Frame[4] = Feedback;
+  Frame[5] = Data1;
+  Frame[6] = Data2;
+
+  if (!Checksum)
+  {
+    Frame[7] = YX5300_CMD_END_BYTE;
+    return YX5300_FRAME_SIZE_SHORT;
+  }
+
+  Sum = YX5300_CodecChecksum(Frame);
+  Frame[7] = (uint8_t)(Sum >> 8);
+  Frame[8] = (uint8_t)(Sum & 0xFF);
+  Frame[9] = YX5300_CMD_END_BYTE;
+  return YX5300_FRAME_SIZE_LONG;
+}
+
+
+static inline YX5300_Decode_t
+YX5300_CodecStartFrame(YX5300_Decoder_t *Decoder, uint8_t Data)
+{
+  // A start byte that breaks a frame is the start of the next frame
+  Decoder->InFrame = (Data == YX5300_CMD_START_BYTE);
+  Decoder->Buffer[0] = Data;
+  Decoder->BufferIndex = Decoder->InFrame;
+  return YX5300_DECODE_PENDING;
+}
+
+
+static inline YX5300_Decode_t
+YX5300_CodecDropFrame(YX5300_Decoder_t *Decoder)
+{
+  uint8_t Count = Decoder->BufferIndex;
+  uint8_t Start = 0;
+  uint8_t i = 0;
+
+  Decoder->InFrame = 0;
+  Decoder->BufferIndex = 0;
+
+  // A start byte in the dropped bytes may be the start of the next frame. Such
+  // a frame has at most 7 bytes yet, so only its version and length are checked.
+  for (Start = 1; Start < Count; Start++)
+  {
+    if (Decoder->Buffer[Start] != YX5300_CMD_START_BYTE)
+      continue;
+
+    for (i = Start; i < Count; i++)
+      Decoder->Buffer[i - Start] = Decoder->Buffer[i];
+    Count -= Start;
+    Start = 0;
+
+    if ((Count > 1 && Decoder->Buffer[1] != YX5300_CMD_VERSION) ||
+        (Count > 2 && Decoder->Buffer[2] != YX5300_FRAME_LEN))
+      continue;
+
+    Decoder->InFrame = 1;
+    Decoder->BufferIndex = Count;
+    break;
+  }
+
+  return YX5300_DECODE_DROP;
+}
+
+
+static inline YX5300_Decode_t
+YX5300_CodecCompleteFrame(YX5300_Decoder_t *Decoder)
+{
+  Decoder->InFrame = 0;
+  Decoder->BufferIndex = 0;
+  return YX5300_DECODE_FRAME;
+}
+
+
+/**
+ * @brief  Pass a received byte to the frame decoder
+ * @note   Frames with checksum are always accepted. The module replies with
+ *         them, so a frame without checksum is more likely a frame with lost
+ *         bytes (its end byte moves to index 7).
+ * @note   After a broken frame, the next start byte in its bytes begins the next
+ *         frame.
+ * @param  Decoder: Pointer to decoder state (all zero at the beginning)
+ * @param  Data: Received byte
+ * @param  Short: 1 to accept frames without checksum, 0 to drop them
+ * @retval YX5300_Decode_t
+ *         - YX5300_DECODE_PENDING: Frame is not completed yet.
+ *         - YX5300_DECODE_FRAME: A frame is completed and stored in Buffer.
+ *         - YX5300_DECODE_DROP: A broken frame is dropped.
+ */
+static inline YX5300_Decode_t
+YX5300_CodecDecode(YX5300_Decoder_t *Decoder, uint8_t Data, uint8_t Short)
+{
+  uint8_t Index = Decoder->BufferIndex;
+
+  if (!Decoder->InFrame || Index >= YX5300_FRAME_SIZE_LONG)
+    return YX5300_CodecStartFrame(Decoder, Data);
+
+  Decoder->Buffer[Index] = Data;
+  Decoder->BufferIndex = Index + 1;
+
+  // Frame Structure  0x7E VER LEN CMD FBK DAT1 DAT2 [CHKH CHKL] 0xEF
+  switch (Index)
+  {
+  case 1:
+    if (Data != YX5300_CMD_VERSION)
+      return YX5300_CodecDropFrame(Decoder);
+    break;
+
+  case 2:
+    if (Data != YX5300_FRAME_LEN)
+      return YX5300_CodecDropFrame(Decoder);
+    break;
+
+  case 7:
+    // High byte of checksum is never less than 0xFA, so 0xEF here is the end
+    // byte of a frame without checksum
+    if (Data == YX5300_CMD_END_BYTE)
+    {
+      if (!Short)
+        return YX5300_CodecDropFrame(Decoder);
+      return YX5300_CodecCompleteFrame(Decoder);
+    }
+    break;
+
+  case 9:
+    if (Data != YX5300_CMD_END_BYTE)
+      return YX5300_CodecDropFrame(Decoder);
+    if (((Decoder->Buffer[7] << 8) | Decoder->Buffer[8]) !=
+        YX5300_CodecChecksum(Decoder->Buffer))
+      return YX5300_CodecDropFrame(Decoder);
+    return YX5300_CodecCompleteFrame(Decoder);
+
+  default:
+    break;
+  }
+
+  return YX5300_DECODE_PENDING;
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //! _YX5300_CODEC_H_
@@ -0,0 +1,380 @@
+/**
+ **********************************************************************************
+ * @file   YX5300_config.h
+ * @author Hossein.M (https://github.com/Hossein-M98)
+ * @brief  Compile-time configuration of YX5300 driver
+ **********************************************************************************
+ *
+ * Copyright (c) 2024 Mahda Embedded System (MIT License)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ **********************************************************************************
+ */
+
+
+/* Define to prevent recursive inclusion ----------------------------------------*/
+#ifndef _YX5300_CONFIG_H_
+#define _YX5300_CONFIG_H_
+
+
+/* Includes ---------------------------------------------------------------------*/
+/**
+ * @brief  A project can override the options below without editing this file,
+ *         by defining YX5300_USER_CONFIG_FILE as the name of its own header
+ *         (e.g. -DYX5300_USER_CONFIG_FILE='"my_yx5300_config.h"').
+ */
+#ifdef YX5300_USER_CONFIG_FILE
+#include YX5300_USER_CONFIG_FILE
+#endif
+
+
+/* Functionality Options --------------------------------------------------------*/
+/**
+ * @brief  Specify the frame format of the commands
+ *         - 0: 8-byte frames without checksum
+ *         - 1: 10-byte frames with checksum
+ */
+#ifndef YX5300_USE_CHECKSUM
+#define YX5300_USE_CHECKSUM           0
+#endif
+
+/**
+ * @brief  Specify whether received frames without checksum are accepted
+ *         - 0: Only 10-byte frames with a valid checksum are accepted (the
+ *              module always replies with them).
+ *         - 1: 8-byte frames without checksum are accepted too. A reply that
+ *              loses two bytes may then be taken as a frame without checksum.
+ */
+#ifndef YX5300_RX_SHORT_FRAMES
+#define YX5300_RX_SHORT_FRAMES        (!YX5300_USE_CHECKSUM)
+#endif
+
+/**
+ * @brief  Specify the initialization method
+ *         - 0: Fixed delays are used after initializing platform and after each
+ *              initialization command.
+ *         - 1: Each initialization step finishes as soon as the response of
+ *              module is received. The response must be passed to the driver
+ *              during YX5300_Init (by linking Receive function or calling
+ *              YX5300_Rx from UART interrupt). YX5300_INIT_TIMEOUT is used as
+ *              the upper bound of waiting for each response.
+ */
+#ifndef YX5300_USE_FAST_INIT
+#define YX5300_USE_FAST_INIT          0
+#endif
+
+/**
+ * @brief  Delay (or maximum waiting time) of each initialization step in ms
+ */
+#ifndef YX5300_INIT_TIMEOUT
+#define YX5300_INIT_TIMEOUT           500
+#endif
+
+/**
+ * @brief  Specify whether the event callback is included
+ *         - 0: Responses only update the status of handler.
+ *         - 1: Each response is reported to the function set by
+ *              YX5300_SetEventCallback.
+ */
+#ifndef YX5300_USE_EVENTS
+#define YX5300_USE_EVENTS             1
+#endif
+
+/**
+ * @brief  Specify the command transmission method
+ *         - 0: Commands are sent immediately by the API functions.
+ *         - 1: Commands are put into a queue by the API functions and are sent one
+ *              by one by the YX5300_Process() function. The next command is sent
+ *              after the ACK of the previous one is received or the ACK timeout
+ *              is expired.
+ */
+#ifndef YX5300_USE_TX_QUEUE
+#define YX5300_USE_TX_QUEUE           0
+#endif
+
+/**
+ * @brief  Number of commands that can be stored in the Tx queue
+ */
+#ifndef YX5300_TX_QUEUE_SIZE
+#define YX5300_TX_QUEUE_SIZE          8
+#endif
+
+/**
+ * @brief  Maximum time to wait for the ACK of a queued command in ms
+ */
+#ifndef YX5300_TX_ACK_TIMEOUT
+#define YX5300_TX_ACK_TIMEOUT         100
+#endif
+
+
+/**
+ * @brief  Minimum time between sending two queued commands in ms, even if the
+ *         ACK of the first one is received sooner
+ */
+#ifndef YX5300_TX_MIN_GAP
+#define YX5300_TX_MIN_GAP             0
+#endif
+
+/**
+ * @brief  Minimum gap between a queued command without feedback and the next
+ *         command in ms
+ */
+#ifndef YX5300_TX_NO_ACK_GAP
+#define YX5300_TX_NO_ACK_GAP          30
+#endif
+
+
+/**
+ * @brief  Specify whether the queued commands are coalesced
+ *         (YX5300_USE_TX_QUEUE must be enabled)
+ *         - 0: All commands are sent one by one.
+ *         - 1: Volume and track steps are converted to absolute commands when
+ *              the result is predictable, and a volume/track command replaces
+ *              the same command that is still waiting in the queue.
+ */
+#ifndef YX5300_USE_TX_COALESCE
+#define YX5300_USE_TX_COALESCE        0
+#endif
+
+
+/**
+ * @brief  Specify whether the failed queued commands are sent again
+ *         (YX5300_USE_TX_QUEUE must be enabled)
+ *         - 0: A command with no ACK or with an error response is lost.
+ *         - 1: A command with feedback is sent again (at most
+ *              YX5300_TX_RETRY_COUNT times) when its ACK timeout is expired or
+ *              the module reports a busy, receiving or checksum error. The ACK
+ *              timeout is computed from the measured ACK round-trip time (as in
+ *              TCP) and doubled on each retry. YX5300_TX_ACK_TIMEOUT (or the
+ *              value set by YX5300_SetAckTimeout) is used as its upper bound and
+ *              before the first measurement.
+ */
+#ifndef YX5300_USE_TX_RETRY
+#define YX5300_USE_TX_RETRY           0
+#endif
+
+/**
+ * @brief  Maximum number of retries of a queued command
+ */
+#ifndef YX5300_TX_RETRY_COUNT
+#define YX5300_TX_RETRY_COUNT         2
+#endif
+
+/**
+ * @brief  Minimum margin of the adaptive ACK timeout over the smoothed ACK
+ *         round-trip time in ms
+ */
+#ifndef YX5300_TX_RTO_MARGIN
+#define YX5300_TX_RTO_MARGIN          10
+#endif
+
+
+/**
+ * @brief  Specify whether the Tx queue has an urgent lane
+ *         (YX5300_USE_TX_QUEUE must be enabled)
+ *         - 0: Commands are sent in the order they are queued.
+ *         - 1: Stop, pause and the commands after YX5300_SetNextUrgent are put
+ *              into the urgent lane and sent before all commands of the normal
+ *              lane (e.g. the queries of media library scan).
+ */
+#ifndef YX5300_USE_TX_PRIORITY
+#define YX5300_USE_TX_PRIORITY        0
+#endif
+
+/**
+ * @brief  Number of commands that can be stored in the urgent lane
+ */
+#ifndef YX5300_TX_URGENT_SIZE
+#define YX5300_TX_URGENT_SIZE         4
+#endif
+
+/**
+ * @brief  Specify whether a stop drops the play commands of the normal lane
+ *         (YX5300_USE_TX_PRIORITY must be enabled)
+ *         - 0: All queued commands are sent.
+ *         - 1: Play, pause and track commands that are waiting in the normal
+ *              lane are dropped when a stop is queued. Volume, query and other
+ *              commands are kept.
+ */
+#ifndef YX5300_TX_PREEMPT
+#define YX5300_TX_PREEMPT             0
+#endif
+
+
+/**
+ * @brief  Specify whether the volume fade engine is included
+ *         (YX5300_USE_TX_QUEUE must be enabled)
+ *         - 0: Volume is only changed by volume commands.
+ *         - 1: YX5300_FadeTo changes the volume step by step in YX5300_Process.
+ *              Each step is sent after the ACK of the previous command, so the
+ *              step rate follows the ACK round-trip time.
+ */
+#ifndef YX5300_USE_FADE
+#define YX5300_USE_FADE               0
+#endif
+
+
+/**
+ * @brief  Specify whether the batch functions are included
+ *         - 0: Each command is sent in a separate Send call.
+ *         - 1: Commands between YX5300_BeginBatch and YX5300_EndBatch are
+ *              encoded into one buffer and sent in one Send call.
+ */
+#ifndef YX5300_USE_BATCH
+#define YX5300_USE_BATCH              0
+#endif
+
+/**
+ * @brief  Maximum number of commands in a batch (the frames of a batch must fit
+ *         in 255 bytes)
+ */
+#ifndef YX5300_BATCH_SIZE
+#define YX5300_BATCH_SIZE             4
+#endif
+
+/**
+ * @brief  Gap between the frames of a batch in ms (left by the platform layer,
+ *         or by the driver if the platform layer sends a part of the batch)
+ */
+#ifndef YX5300_BATCH_GAP
+#define YX5300_BATCH_GAP              YX5300_TX_NO_ACK_GAP
+#endif
+
+
+/**
+ * @brief  Specify whether the playlist engine is included
+ */
+#ifndef YX5300_USE_PLAYLIST
+#define YX5300_USE_PLAYLIST           0
+#endif
+
+/**
+ * @brief  Maximum number of items in the playlist
+ */
+#ifndef YX5300_PLAYLIST_SIZE
+#define YX5300_PLAYLIST_SIZE          16
+#endif
+
+/**
+ * @brief  Fade-in time of playlist items that have a volume in ms (0: the volume
+ *         is set at once). YX5300_USE_FADE must be enabled.
+ */
+#ifndef YX5300_PLAYLIST_FADE_TIME
+#define YX5300_PLAYLIST_FADE_TIME     0
+#endif
+
+
+/**
+ * @brief  Specify whether the confirmed state of module is cached
+ *         - 0: All commands and queries are sent to the module.
+ *         - 1: Volume, track, folder and play state confirmed by the module
+ *              (ACK or query reply) are cached. Commands that would not change
+ *              the cached state are not sent, and status queries return the
+ *              cached value if it is not older than YX5300_CACHE_MAX_AGE.
+ *              YX5300_USE_TX_QUEUE must be enabled, so each ACK belongs to the
+ *              only command that is waiting for it.
+ */
+#ifndef YX5300_USE_CACHE
+#define YX5300_USE_CACHE              0
+#endif
+
+/**
+ * @brief  Maximum age of a cached value that is returned by status queries in ms
+ */
+#ifndef YX5300_CACHE_MAX_AGE
+#define YX5300_CACHE_MAX_AGE          1000
+#endif
+
+
+/**
+ * @brief  Specify whether the media library index is included
+ *         - 0: Folder and file counts are only reported by events.
+ *         - 1: File count of each folder is stored in a buffer given by
+ *              YX5300_LibrarySetBuffer. The index is built after initialization
+ *              and after inserting the memory card.
+ */
+#ifndef YX5300_USE_LIBRARY
+#define YX5300_USE_LIBRARY            0
+#endif
+
+/**
+ * @brief  Maximum time to wait for the reply of a library scan query in ms
+ *         (YX5300_Process must be called periodically and GetTick must be
+ *         linked)
+ */
+#ifndef YX5300_LIBRARY_TIMEOUT
+#define YX5300_LIBRARY_TIMEOUT        500
+#endif
+
+/**
+ * @brief  Number of times a library scan query with no reply is sent again
+ *         before the scan is stopped (Library.State becomes
+ *         YX5300_LIBRARY_EMPTY)
+ */
+#ifndef YX5300_LIBRARY_RETRIES
+#define YX5300_LIBRARY_RETRIES        2
+#endif
+
+
+/**
+ * @brief  Specify whether the playback position is estimated
+ *         - 0: Position of the playing track is not known by the driver.
+ *         - 1: Play time of the current track is counted from the ACKs of
+ *              play, pause and stop commands (GetTick must be linked,
+ *              feedback must be enabled and YX5300_USE_TX_QUEUE must be
+ *              enabled).
+ */
+#ifndef YX5300_USE_POSITION
+#define YX5300_USE_POSITION           0
+#endif
+
+
+/**
+ * @brief  Specify whether the link statistics are counted in the handler
+ */
+#ifndef YX5300_USE_STATS
+#define YX5300_USE_STATS              0
+#endif
+
+
+/**
+ * @brief  Specify whether the group functions are included
+ *         - 0: Each handler is processed separately by the user.
+ *         - 1: Several handlers (modules) can be processed by one context with
+ *              YX5300_GroupProcess.
+ */
+#ifndef YX5300_USE_GROUP
+#define YX5300_USE_GROUP              1
+#endif
+
+/**
+ * @brief  Specify whether the frame codec functions are included
+ *         - 0: Frames are only encoded and decoded by the handler functions.
+ *         - 1: YX5300_EncodeFrame, YX5300_DecoderInit and YX5300_DecodeFrame
+ *              can be used without a handler (e.g. from ISR).
+ * @note   The inline functions of YX5300_codec.h can be used in both cases.
+ */
+#ifndef YX5300_USE_CODEC_API
+#define YX5300_USE_CODEC_API          0
+#endif
+
+
+
+#endif //! _YX5300_CONFIG_H_